@@ -0,0 +1,442 @@
+// Throughput and latency benchmark of SyncQueue/Channel backends, dispatch modes and Thread::async round-trips.
+// Every result is printed to stdout as one JSON object per line, progress goes to stderr.
+//
+// Usage:
+//      queue_benchmark [--quick] [--duration-ms N] [--filter text]
+//
+//      --quick         smaller matrix (1/4/16 producers, one payload and capacity) for a fast smoke run
+//      --duration-ms   how long producers send in each run (default 200)
+//      --filter        only runs whose name contains text, e.g. --filter channel/Sharded
+//
+#include "mdsp_common/wrapper.h"
+#include "thread.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <variant>
+
+namespace bench
+{
+    using namespace mdsp;
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        bool quick = false;
+        Time duration = Time::FromMilliseconds(200);
+        std::string filter;
+    };
+
+    int64_t nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    // Latencies in ns, recorded by one thread, merged once the run is over
+    struct Samples
+    {
+        // Bounds the memory of long runs, every message is still counted
+        static constexpr size_t MaxSamples = 1 << 20;
+
+        std::vector<int64_t> values;
+        uint64_t count = 0;
+
+        Samples()
+        {
+            values.reserve(MaxSamples);
+        }
+
+        void add(int64_t latency)
+        {
+            ++count;
+
+            if (values.size() < MaxSamples)
+                values.push_back(latency);
+        }
+    };
+
+    struct Percentiles
+    {
+        int64_t p50 = 0;
+        int64_t p90 = 0;
+        int64_t p99 = 0;
+        int64_t p999 = 0;
+        int64_t max = 0;
+    };
+
+    Percentiles percentiles(std::vector<Samples>& samples)
+    {
+        std::vector<int64_t> all;
+
+        for (auto& s : samples)
+            all.insert(all.end(), s.values.begin(), s.values.end());
+
+        if (all.empty())
+            return {};
+
+        std::sort(all.begin(), all.end());
+
+        auto at = [&](double q) { return all[std::min(all.size() - 1, size_t(q * double(all.size())))]; };
+
+        return { at(0.5), at(0.9), at(0.99), at(0.999), all.back() };
+    }
+
+    struct Result
+    {
+        std::string name;
+        std::string benchmark;
+        std::string backend;
+        std::string dispatch;
+        size_t producers = 0;
+        size_t consumers = 0;
+        size_t payload = 0;
+        size_t capacity = 0;
+        uint64_t messages = 0;
+        double seconds = 0;
+        Percentiles latency;
+    };
+
+    void print(const Result& r)
+    {
+        std::printf("{\"name\":\"%s\",\"benchmark\":\"%s\",\"backend\":\"%s\",\"dispatch\":\"%s\","
+            "\"producers\":%zu,\"consumers\":%zu,\"payload\":%zu,\"capacity\":%zu,"
+            "\"messages\":%llu,\"seconds\":%.6f,\"throughput\":%.1f,"
+            "\"p50_ns\":%lld,\"p90_ns\":%lld,\"p99_ns\":%lld,\"p999_ns\":%lld,\"max_ns\":%lld}\n",
+            r.name.c_str(), r.benchmark.c_str(), r.backend.c_str(), r.dispatch.c_str(),
+            r.producers, r.consumers, r.payload, r.capacity,
+            (unsigned long long)r.messages, r.seconds, r.seconds > 0 ? double(r.messages) / r.seconds : 0.0,
+            (long long)r.latency.p50, (long long)r.latency.p90, (long long)r.latency.p99, (long long)r.latency.p999, (long long)r.latency.max);
+        std::fflush(stdout);
+    }
+
+    // Message of Size bytes, carrying its send time
+    template<size_t Size>
+    struct Payload
+    {
+        int64_t sent = 0;
+        std::array<std::byte, Size - sizeof(int64_t)> data{};
+    };
+
+    struct Stop {};
+
+    template<size_t Size>
+    using Messages = std::variant<Stop, Payload<Size>>;
+
+    // singleConsumer backends only run with one consumer
+    struct MutexBackend { using type = backend::Mutex; static constexpr const char* name = "Mutex"; static constexpr bool singleConsumer = false; };
+    struct RingBackend { using type = backend::Ring; static constexpr const char* name = "Ring"; static constexpr bool singleConsumer = false; };
+    struct ShardedBackend { using type = backend::Sharded<8>; static constexpr const char* name = "Sharded"; static constexpr bool singleConsumer = true; };
+    struct MPMCBackend { using type = backend::MPMC; static constexpr const char* name = "MPMC"; static constexpr bool singleConsumer = false; };
+
+    template<typename Dispatch>
+    constexpr const char* dispatchName()
+    {
+        if constexpr (std::is_same_v<Dispatch, dispatch::Priority>)
+            return "Priority";
+        else
+            return "Serial";
+    }
+
+    // producers send for options.duration, then the channel is closed and consumers drain it
+    template<typename Backend, typename Dispatch, size_t Size>
+    Result runChannel(const Options& options, size_t producers, size_t consumers, size_t capacity)
+    {
+        using Ch = Channel<Messages<Size>, typename Backend::type>;
+
+        Ch channel;
+        channel.open(ChannelConfig{}.withCapacity(capacity).withRecvTimeout(Time::FromSeconds(1)));
+
+        std::atomic_bool stop = false;
+        std::atomic<size_t> ready = 0;
+        std::vector<Samples> samples(consumers);
+        std::vector<std::thread> threads;
+
+        for (size_t c = 0; c < consumers; ++c)
+        {
+            threads.emplace_back([&, c]() {
+                ++ready;
+
+                while (true)
+                {
+                    auto [status, msg] = channel.recv();
+
+                    if (status == SyncQStatus::Shutdown)
+                        break;
+
+                    if (auto* payload = std::get_if<Payload<Size>>(&msg))
+                        samples[c].add(nowNs() - payload->sent);
+                }
+            });
+        }
+
+        for (size_t p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&]() {
+                ++ready;
+
+                Payload<Size> payload;
+
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    payload.sent = nowNs();
+                    channel.template send<Dispatch>(payload);
+                }
+            });
+        }
+
+        while (ready < producers + consumers)
+            std::this_thread::yield();
+
+        auto start = Clock::now();
+
+        std::this_thread::sleep_for(options.duration.chronoMicroseconds());
+        stop = true;
+
+        for (size_t p = consumers; p < threads.size(); ++p)
+            threads[p].join();
+
+        channel.close(ClearCache(false));
+
+        for (size_t c = 0; c < consumers; ++c)
+            threads[c].join();
+
+        Result result;
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        for (auto& s : samples)
+            result.messages += s.count;
+
+        result.latency = percentiles(samples);
+
+        return result;
+    }
+
+    // Thread::async round-trips: every caller sends a Ping and waits for it with Awaitable::wait
+    struct Ping : Awaitable {};
+
+    using PingCommands = std::variant<Stop, Ping>;
+
+    struct PingState {};
+
+    class PingThread
+        : public cisim::Thread<PingState, PingCommands>
+    {
+    public:
+        void execute(PingState&, Stop&) {}
+        void execute(PingState&, Ping&) {}
+    };
+
+    Result runRoundTrip(const Options& options, size_t callers)
+    {
+        PingThread thread;
+        thread.start(PingState{}, cisim::ThreadConfig(ChannelConfig{}.withCapacity(1024)));
+
+        std::atomic_bool stop = false;
+        std::atomic<size_t> ready = 0;
+        std::vector<Samples> samples(callers);
+        std::vector<std::thread> threads;
+
+        for (size_t c = 0; c < callers; ++c)
+        {
+            threads.emplace_back([&, c]() {
+                ++ready;
+
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    auto sent = nowNs();
+                    auto done = thread.async<Ping>();
+
+                    if (done.wait(Time::FromSeconds(1)) != Awaitable::OK)
+                        break;
+
+                    samples[c].add(nowNs() - sent);
+                }
+            });
+        }
+
+        while (ready < callers)
+            std::this_thread::yield();
+
+        auto start = Clock::now();
+
+        std::this_thread::sleep_for(options.duration.chronoMicroseconds());
+        stop = true;
+
+        for (auto& t : threads)
+            t.join();
+
+        Result result;
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        thread.stop();
+
+        for (auto& s : samples)
+            result.messages += s.count;
+
+        result.latency = percentiles(samples);
+
+        return result;
+    }
+
+    class Runner
+    {
+    protected:
+        Options _options;
+
+        std::vector<size_t> _producers;
+        std::vector<size_t> _consumers;
+        std::vector<size_t> _capacities;
+
+        bool selected(const std::string& name) const
+        {
+            return _options.filter.empty() || name.find(_options.filter) != std::string::npos;
+        }
+
+        template<typename Backend, typename Dispatch, size_t Size>
+        void channelRuns()
+        {
+            for (auto consumers : _consumers)
+            {
+                // Sharded queues are drained by one consumer, several would race on the shards
+                if (Backend::singleConsumer && consumers > 1)
+                    continue;
+
+                for (auto producers : _producers)
+                {
+                    for (auto capacity : _capacities)
+                    {
+                        auto name = std::string("channel/") + Backend::name + "/" + dispatchName<Dispatch>()
+                            + "/p" + std::to_string(producers) + "/c" + std::to_string(consumers)
+                            + "/s" + std::to_string(Size) + "/cap" + std::to_string(capacity);
+
+                        if (!selected(name))
+                            continue;
+
+                        std::fprintf(stderr, "%s\n", name.c_str());
+
+                        auto result = runChannel<Backend, Dispatch, Size>(_options, producers, consumers, capacity);
+
+                        result.name = name;
+                        result.benchmark = "channel";
+                        result.backend = Backend::name;
+                        result.dispatch = dispatchName<Dispatch>();
+                        result.producers = producers;
+                        result.consumers = consumers;
+                        result.payload = Size;
+                        result.capacity = capacity;
+
+                        print(result);
+                    }
+                }
+            }
+        }
+
+        template<typename Backend, size_t Size>
+        void backendRuns()
+        {
+            channelRuns<Backend, dispatch::Serial, Size>();
+
+            // Front insertion is only supported by the SyncQueue based backends
+            if constexpr (requires (typename Backend::type::template Queue<Messages<Size>> q, Messages<Size> m) { q.addFront(m); })
+                channelRuns<Backend, dispatch::Priority, Size>();
+        }
+
+        template<size_t Size>
+        void payloadRuns()
+        {
+            backendRuns<MutexBackend, Size>();
+            backendRuns<RingBackend, Size>();
+            backendRuns<ShardedBackend, Size>();
+            backendRuns<MPMCBackend, Size>();
+        }
+
+        void roundTripRuns()
+        {
+            for (auto callers : _producers)
+            {
+                auto name = "roundtrip/Mutex/Serial/p" + std::to_string(callers);
+
+                if (!selected(name))
+                    continue;
+
+                std::fprintf(stderr, "%s\n", name.c_str());
+
+                auto result = runRoundTrip(_options, callers);
+
+                result.name = name;
+                result.benchmark = "roundtrip";
+                result.backend = MutexBackend::name;
+                result.dispatch = "Serial";
+                result.producers = callers;
+                result.consumers = 1;
+                result.payload = sizeof(Ping);
+                result.capacity = 1024;
+
+                print(result);
+            }
+        }
+
+    public:
+        Runner(const Options& options)
+            : _options(options)
+        {
+            if (options.quick)
+            {
+                _producers = { 1, 4, 16 };
+                _consumers = { 1 };
+                _capacities = { 1024 };
+            }
+            else
+            {
+                _producers = { 1, 2, 4, 8, 16, 32 };
+                _consumers = { 1, 2, 4 };
+                _capacities = { 64, 1024 };
+            }
+        }
+
+        void run()
+        {
+            payloadRuns<64>();
+
+            if (!_options.quick)
+            {
+                payloadRuns<16>();
+                payloadRuns<2048>();
+            }
+
+            roundTripRuns();
+        }
+    };
+}
+
+int main(int argc, char** argv)
+{
+    bench::Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--quick") == 0)
+            options.quick = true;
+        else if (std::strcmp(argv[i], "--duration-ms") == 0 && i + 1 < argc)
+            options.duration = mdsp::Time::FromMilliseconds(std::atoll(argv[++i]));
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            options.filter = argv[++i];
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--quick] [--duration-ms N] [--filter text]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    bench::Runner(options).run();
+
+    return 0;
+}
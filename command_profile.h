@@ -0,0 +1,190 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <vector>
+#include <variant>
+#include <optional>
+#include <string_view>
+#include <algorithm>
+#include <bit>
+#include <utility>
+#include "mdsp_common/timestamp.h"
+#include "mdsp_common/meta.h"
+#include "mdsp_common/queue_metrics.h"
+
+namespace cisim
+{
+    // Execution statistics of one command alternative (or of tick)
+    struct CommandStats
+    {
+        // Bucket i counts durations in [2^(i-1), 2^i) microseconds, bucket 0 counts durations under 1 us
+        static constexpr size_t Buckets = 32;
+
+        size_t index = 0;
+        std::string_view name;
+
+        uint64_t count = 0;
+        Time total = Time::Zero();
+        Time max = Time::Zero();
+        std::array<uint64_t, Buckets> durations{};
+
+        Time mean() const
+        {
+            return count > 0 ? total / int64_t(count) : Time::Zero();
+        }
+
+        // Upper bound (in microseconds) of the bucket the given fraction (e.g. 0.99) of durations falls into
+        uint64_t percentile(double fraction) const
+        {
+            uint64_t threshold = uint64_t(double(count) * fraction);
+            uint64_t seen = 0;
+
+            for (size_t i = 0; i < Buckets; ++i)
+            {
+                seen += durations[i];
+
+                if (seen >= threshold && seen > 0)
+                    return i == 0 ? 0 : (uint64_t(1) << i) - 1;
+            }
+
+            return 0;
+        }
+    };
+
+    struct ThreadProfile
+    {
+        // One entry per Commands alternative, in variant order
+        std::vector<CommandStats> commands;
+        CommandStats tick;
+
+        // Queueing delay (enqueue to dequeue) of the thread channel, only with backend::Instrumented
+        std::optional<QueueMetricsSnapshot> queue;
+
+        // Alternatives sorted by the total execution time, the most expensive first
+        std::vector<CommandStats> byTotal() const
+        {
+            auto sorted = commands;
+
+            std::sort(sorted.begin(), sorted.end(), [](const CommandStats& lhs, const CommandStats& rhs) {
+                return lhs.total > rhs.total;
+            });
+
+            return sorted;
+        }
+    };
+
+    // Per-alternative execution time counters of a Thread (ThreadConfig::profile).
+    // Only the thread itself records, so the counters are updated with relaxed load/store pairs instead of RMW operations.
+    // snapshot() and reset() can be called from any thread, reset() is applied by the thread on its next record.
+    template<typename Commands>
+    class CommandProfiler
+    {
+    protected:
+        static constexpr size_t Alternatives = std::variant_size_v<Commands>;
+
+        struct Entry
+        {
+            std::atomic<uint64_t> count = 0;
+            std::atomic<Time> total = Time::Zero();
+            std::atomic<Time> max = Time::Zero();
+            std::array<std::atomic<uint64_t>, CommandStats::Buckets> durations{};
+
+            void record(Time duration)
+            {
+                auto bucket = std::bit_width(uint64_t((std::max)(duration.microseconds<int64_t>(), int64_t(0))));
+                auto& slot = durations[(std::min)(size_t(bucket), CommandStats::Buckets - 1)];
+
+                slot.store(slot.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                total.store(total.load(std::memory_order_relaxed) + duration, std::memory_order_relaxed);
+
+                if (duration > max.load(std::memory_order_relaxed))
+                    max.store(duration, std::memory_order_relaxed);
+
+                count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            void clear()
+            {
+                count.store(0, std::memory_order_relaxed);
+                total.store(Time::Zero(), std::memory_order_relaxed);
+                max.store(Time::Zero(), std::memory_order_relaxed);
+
+                for (auto& slot : durations)
+                    slot.store(0, std::memory_order_relaxed);
+            }
+
+            CommandStats stats(size_t index, std::string_view name) const
+            {
+                CommandStats stats;
+
+                stats.index = index;
+                stats.name = name;
+                stats.count = count.load(std::memory_order_acquire);
+                stats.total = total.load(std::memory_order_relaxed);
+                stats.max = max.load(std::memory_order_relaxed);
+
+                for (size_t i = 0; i < CommandStats::Buckets; ++i)
+                    stats.durations[i] = durations[i].load(std::memory_order_relaxed);
+
+                return stats;
+            }
+        };
+
+        template<size_t... Is>
+        static constexpr std::array<std::string_view, Alternatives> namesOf(std::index_sequence<Is...>)
+        {
+            return { meta::TypeName<std::variant_alternative_t<Is, Commands>>()... };
+        }
+
+        static constexpr std::array<std::string_view, Alternatives> Names = namesOf(std::make_index_sequence<Alternatives>());
+
+        std::array<Entry, Alternatives> _commands;
+        Entry _tick;
+        std::atomic_bool _resetPending = false;
+
+        void applyReset()
+        {
+            if (!_resetPending.load(std::memory_order_relaxed)) [[likely]]
+                return;
+
+            _resetPending.store(false, std::memory_order_relaxed);
+
+            for (auto& entry : _commands)
+                entry.clear();
+
+            _tick.clear();
+        }
+
+    public:
+        void record(size_t index, Time duration)
+        {
+            applyReset();
+            _commands[index].record(duration);
+        }
+
+        void recordTick(Time duration)
+        {
+            applyReset();
+            _tick.record(duration);
+        }
+
+        void reset()
+        {
+            _resetPending.store(true, std::memory_order_relaxed);
+        }
+
+        ThreadProfile snapshot() const
+        {
+            ThreadProfile profile;
+
+            profile.commands.reserve(Alternatives);
+
+            for (size_t i = 0; i < Alternatives; ++i)
+                profile.commands.push_back(_commands[i].stats(i, Names[i]));
+
+            profile.tick = _tick.stats(Alternatives, "tick");
+
+            return profile;
+        }
+    };
+}
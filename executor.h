@@ -0,0 +1,388 @@
+#pragma once
+#include <thread>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <coroutine>
+#include <cassert>
+#include "thread.h"
+
+namespace cisim
+{
+    class Executor;
+
+    // Unit of work scheduled on Executor, it's queued at most once at a time
+    // so whatever run() processes is never processed on two workers at once
+    class Mailbox
+    {
+    protected:
+        friend class Executor;
+
+        // Set by start(), until then schedule() does nothing
+        std::atomic<Executor*> _executor = nullptr;
+        std::atomic_bool _scheduled = false;
+        void (*_run)(Mailbox&) = nullptr;
+
+        void run()
+        {
+            _run(*this);
+        }
+
+    public:
+        virtual ~Mailbox()
+        {}
+
+        void schedule();
+    };
+
+    // Fixed pool of worker threads running Mailboxes (e.g. Actors).
+    // Each worker has its own queue, mailboxes scheduled from a worker go to its own queue,
+    // the others are distributed round-robin. Idle workers steal from the back of other workers' queues
+    // before parking.
+    //
+    // Executor is also a Scheduler: coroutines that co_await an Awaitable on a worker are resumed on the pool.
+    class Executor : public Scheduler
+    {
+    protected:
+        // Scheduled Mailbox or resumed coroutine
+        struct Job
+        {
+            Mailbox* mailbox = nullptr;
+            std::coroutine_handle<> coroutine = nullptr;
+
+            void run()
+            {
+                if (mailbox)
+                    mailbox->run();
+                else
+                    coroutine.resume();
+            }
+        };
+
+        struct Worker
+        {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+            std::thread thread;
+        };
+
+        static inline thread_local Executor* _current = nullptr;
+        static inline thread_local size_t _index = 0;
+
+        std::vector<std::unique_ptr<Worker>> _workers;
+        std::atomic<size_t> _next = 0;
+
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::atomic<size_t> _pending = 0;
+        std::atomic<size_t> _sleeping = 0;
+        bool _running = true;
+
+        std::optional<Job> take(size_t index)
+        {
+            {
+                auto& own = *_workers[index];
+                std::lock_guard lock{ own.mutex };
+
+                if (!own.jobs.empty())
+                {
+                    auto job = own.jobs.front();
+                    own.jobs.pop_front();
+
+                    return job;
+                }
+            }
+
+            for (size_t i = 1; i < _workers.size(); ++i)
+            {
+                auto& victim = *_workers[(index + i) % _workers.size()];
+                std::lock_guard lock{ victim.mutex };
+
+                if (!victim.jobs.empty())
+                {
+                    auto job = victim.jobs.back();
+                    victim.jobs.pop_back();
+
+                    return job;
+                }
+            }
+
+            return std::nullopt;
+        }
+
+        void push(Job job)
+        {
+            size_t index = _current == this ? _index : _next.fetch_add(1) % _workers.size();
+
+            {
+                auto& worker = *_workers[index];
+                std::lock_guard lock{ worker.mutex };
+
+                worker.jobs.push_back(job);
+            }
+
+            _pending.fetch_add(1);
+
+            if (_sleeping.load() > 0)
+            {
+                { std::lock_guard lock{ _mutex }; }
+                _wake.notify_one();
+            }
+        }
+
+        void work(size_t index)
+        {
+            _current = this;
+            _index = index;
+            makeCurrent(this);
+
+            while (true)
+            {
+                if (auto job = take(index))
+                {
+                    _pending.fetch_sub(1);
+                    job->run();
+
+                    continue;
+                }
+
+                std::unique_lock lock{ _mutex };
+
+                _sleeping.fetch_add(1);
+                _wake.wait(lock, [&]() { return _pending.load() > 0 || !_running; });
+                _sleeping.fetch_sub(1);
+
+                if (!_running && _pending.load() == 0)
+                    break;
+            }
+
+            _current = nullptr;
+            makeCurrent(nullptr);
+        }
+
+    public:
+        explicit Executor(size_t workers = std::max(1u, std::thread::hardware_concurrency()))
+        {
+            for (size_t i = 0; i < workers; ++i)
+                _workers.push_back(std::make_unique<Worker>());
+
+            for (size_t i = 0; i < workers; ++i)
+                _workers[i]->thread = std::thread([this, i]() { work(i); });
+        }
+
+        Executor(const Executor&) = delete;
+        Executor& operator=(const Executor&) = delete;
+
+        // Runs what's already scheduled and joins the workers, mailboxes have to be stopped before this
+        ~Executor()
+        {
+            {
+                std::lock_guard lock{ _mutex };
+                _running = false;
+            }
+
+            _wake.notify_all();
+
+            for (auto& worker : _workers)
+            {
+                if (worker->thread.joinable())
+                    worker->thread.join();
+            }
+        }
+
+        size_t workers() const
+        {
+            return _workers.size();
+        }
+
+        // Executor whose worker is the calling thread, nullptr if it isn't a worker thread
+        static Executor* current()
+        {
+            return _current;
+        }
+
+        void submit(Mailbox* mailbox)
+        {
+            push({ mailbox, nullptr });
+        }
+
+        void post(std::coroutine_handle<> coroutine) override
+        {
+            push({ nullptr, coroutine });
+        }
+    };
+
+    inline void Mailbox::schedule()
+    {
+        auto executor = _executor.load(std::memory_order_acquire);
+
+        if (executor && !_scheduled.exchange(true))
+            executor->submit(this);
+    }
+
+    // cisim::Thread counterpart that doesn't own a thread, it's run on an Executor whenever it has messages.
+    // Handlers (execute, tick, onStart, onStop, onEnter, onExit) and async API are the same as Thread's.
+    // Each run executes up to ThreadConfig::batch commands and calls tick once, then yields the worker.
+    // ThreadConfig CPU affinity, scheduling and name don't apply, the actor has no thread of its own.
+    //
+    // Commands shouldn't block on Awaitable::wait for other actors on the same executor,
+    // since that blocks the worker (and with all workers blocked, the executor).
+    // Use co_await instead, the coroutine is resumed on one of the workers, not necessarily while the actor runs,
+    // so it shouldn't touch the actor's state directly (send a command to it instead).
+    template <typename State, typename Commands, typename Backend = backend::Mutex>
+    class Actor
+        : public DefaultHandlers<State>
+        , public Mailbox
+    {
+    protected:
+        // Commands as stored in the channel, large alternatives are boxed with backend::OutOfLine
+        using Message = typename Channel<Commands, Backend>::Queue::value_type;
+
+        Channel<Commands, Backend> channel;
+        std::optional<State> state;
+        std::vector<Message> commands;
+        size_t batch = 1;
+        bool entered = false;
+        std::atomic_bool finished = false;
+
+        template <typename Self>
+        static void process(Self& self)
+        {
+            // Scheduled by a command sent after stop(), it's dropped by the next start()
+            if (self.finished)
+            {
+                self._scheduled = false;
+                return;
+            }
+
+            if (!self.running)
+            {
+                if (self.entered)
+                    self.onExit(*self.state);
+
+                self.finished = true;
+                self.finished.notify_all();
+
+                return;
+            }
+
+            if (!self.entered)
+            {
+                self.onEnter(*self.state);
+                self.entered = true;
+            }
+
+            self.commands.clear();
+
+            auto [status, count] = self.channel.recvBatch(std::back_inserter(self.commands), self.batch, Time());
+
+            for (auto& cmd : self.commands)
+            {
+                visitUnboxed([&](auto&& command) mutable {
+
+                    using C = std::decay_t<decltype(command)>;
+
+                    self.execute(*self.state, command);
+
+                    if constexpr (cisim::is_awaitable<C>)
+                        command.notify();
+                }, cmd);
+            }
+
+            if (count > 0)
+                self.tick(*self.state);
+
+            self._scheduled = false;
+
+            if (!self.running || !self.channel.empty())
+                self.schedule();
+        }
+
+    public:
+        std::atomic_bool running = false;
+
+        Actor()
+        {}
+
+        virtual ~Actor()
+        {}
+
+        template <typename Self>
+        void start(this Self&& self, Executor& executor, State state, const ThreadConfig& config)
+        {
+            using Derived = std::remove_reference_t<Self>;
+
+            if (self.running)
+                return;
+
+            self.channel.open(config.channel);
+
+            self.state.emplace(std::move(state));
+            self.batch = std::max<size_t>(1, config.batch);
+            self.entered = false;
+            self.finished = false;
+
+            self._scheduled = false;
+            self._executor.store(&executor, std::memory_order_release);
+            self._run = [](Mailbox& mailbox) {
+                process(static_cast<Derived&>(mailbox));
+            };
+
+            self.running = true;
+
+            self.onStart(*self.state);
+
+            // Always scheduled, so onEnter runs before the first command
+            self.schedule();
+        }
+
+        // Waits for the current run to finish and calls onExit on a worker, then closes the channel like Thread::stop:
+        // queued commands are dropped and their Awaitables are unblocked with Shutdown.
+        // It blocks until a worker runs the actor, so it mustn't be called on a worker of the same executor
+        // (e.g. from a command), with all workers waiting there that would deadlock.
+        template <typename Self>
+        void stop(this Self&& self)
+        {
+            assert(Executor::current() != self._executor.load() && "Actor::stop called on a worker of its own executor");
+
+            if (!self.running.exchange(false))
+                return;
+
+            self.schedule();
+            self.finished.wait(false);
+
+            self.channel.close();
+
+            self.onStop();
+        }
+
+        template<typename Dispatch = dispatch::Serial, typename T>
+        void async(T cmd)
+        {
+            channel.template send<Dispatch>(std::move(cmd));
+
+            schedule();
+        }
+
+        template<typename T, typename Dispatch = dispatch::Serial, typename... Ts>
+        typename T::awaitable_type async(Ts&&... args)
+        {
+            static_assert(cisim::is_awaitable<T>,
+                "T is not awaitable and can't be used with async<T>(Ts...) overload"
+                );
+
+            typename T::awaitable_type awaitable(1);
+
+            channel.template send<Dispatch>(T{ awaitable, std::forward<Ts>(args)... });
+
+            schedule();
+
+            return awaitable;
+        }
+    };
+}
@@ -0,0 +1,212 @@
+#pragma once
+#include <atomic>
+#include <optional>
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include "timestamp.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(_M_ARM64) || defined(_M_ARM)
+#include <intrin.h>
+#endif
+
+#if defined(_WIN32)
+extern "C"
+{
+    __declspec(dllimport) int __stdcall WaitOnAddress(volatile void* address, void* compareAddress, size_t addressSize, unsigned long milliseconds);
+    __declspec(dllimport) void __stdcall WakeByAddressAll(void* address);
+}
+#pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+namespace mdsp
+{
+    // CPU hint for busy-wait loops (pause/yield instruction), lets the sibling hyperthread run and saves power
+    inline void spinPause()
+    {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(_M_ARM64) || defined(_M_ARM)
+        __yield();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#endif
+    }
+
+    // steady_clock time point timeout from now, saturated so that huge timeouts (e.g. Time::Max()) don't overflow
+    inline std::chrono::steady_clock::time_point deadlineAfter(Time timeout)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        auto now = Clock::now();
+        auto left = std::chrono::duration_cast<std::chrono::microseconds>(Clock::time_point::max() - now);
+        auto wait = std::clamp(timeout.chronoMicroseconds(), std::chrono::microseconds::zero(), left);
+
+        return now + std::chrono::duration_cast<Clock::duration>(wait);
+    }
+
+    // How long a consumer busy-waits before it blocks: up to spins polls (or for budget, whichever lasts longer),
+    // then up to yields rounds of std::this_thread::yield(). Default policy blocks right away.
+    //
+    // Spinning trades CPU time for latency, the blocking wake-up (futex/condition_variable) costs tens of us,
+    // while a spinning consumer picks up an item within a few hundred ns.
+    struct SpinPolicy
+    {
+        size_t spins = 0;
+        Time budget = Time::Zero();
+        size_t yields = 0;
+
+        constexpr bool enabled() const
+        {
+            return spins != 0 || budget > Time::Zero() || yields != 0;
+        }
+
+        // Polls ready() until it returns true or the policy is exhausted (never longer than timeout, a zero timeout
+        // polls once), returns the last ready() result
+        template<typename F>
+        bool spinUntil(Time timeout, F&& ready) const
+        {
+            using Clock = std::chrono::steady_clock;
+
+            if (timeout <= Time::Zero())
+                return ready();
+
+            auto deadline = deadlineAfter(timeout);
+            auto budgetEnd = deadlineAfter(std::min(budget, timeout));
+            bool timed = budget > Time::Zero();
+
+            // The clock is only read every 64 polls, the deadline bounds the spins count too
+            for (size_t i = 0; i < spins || timed; ++i)
+            {
+                if (ready())
+                    return true;
+
+                spinPause();
+
+                if (i % 64 == 63)
+                {
+                    auto now = Clock::now();
+
+                    if (now >= deadline || (i + 1 >= spins && (!timed || now >= budgetEnd)))
+                        break;
+                }
+            }
+
+            for (size_t i = 0; i < yields && Clock::now() < deadline; ++i)
+            {
+                if (ready())
+                    return true;
+
+                std::this_thread::yield();
+            }
+
+            return ready();
+        }
+    };
+
+    // std::atomic<uint32_t>::wait counterpart with a timeout, backed by WaitOnAddress on Windows and futex on Linux.
+    // Blocks while word == expected, for at most timeout (forever if it's empty or Time::Max()).
+    // It can return early (spuriously, on timeout or when word changed), callers have to recheck their condition.
+    // Waiters are only woken by atomicWakeAll, not by std::atomic::notify_*.
+    inline void atomicWait(std::atomic<uint32_t>& word, uint32_t expected, std::optional<Time> timeout = {})
+    {
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free);
+
+        if (timeout && *timeout <= Time::Zero())
+            return;
+
+        if (timeout && *timeout >= Time::Max())
+            timeout.reset();
+
+#if defined(_WIN32)
+        constexpr unsigned long Infinite = 0xFFFFFFFF;
+
+        unsigned long milliseconds = Infinite;
+
+        // Rounded up, so that the caller doesn't spin through the last sub-millisecond
+        if (timeout)
+            milliseconds = (unsigned long)std::clamp<int64_t>((timeout->microseconds<int64_t>() + 999) / 1000, 1, Infinite - 1);
+
+        WaitOnAddress(&word, &expected, sizeof(expected), milliseconds);
+#elif defined(__linux__)
+        timespec time{};
+
+        // Whole seconds first, nanoseconds of the whole timeout overflow int64_t for long timeouts
+        if (timeout)
+        {
+            auto seconds = timeout->seconds<int64_t>();
+
+            time.tv_sec = time_t(seconds);
+            time.tv_nsec = long((*timeout - Time::FromSeconds(seconds)).nanoseconds<int64_t>());
+        }
+
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, timeout ? &time : nullptr, nullptr, 0);
+#else
+        if (!timeout)
+        {
+            word.wait(expected);
+            return;
+        }
+
+        // No timed wait available, poll
+        auto deadline = deadlineAfter(*timeout);
+
+        while (word.load() == expected && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+#endif
+    }
+
+    inline void atomicWakeAll(std::atomic<uint32_t>& word)
+    {
+#if defined(_WIN32)
+        WakeByAddressAll(&word);
+#elif defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#else
+        word.notify_all();
+#endif
+    }
+
+    // Wake-up signal a consumer parks on while it waits for any of several sources (see WaitSet).
+    // Sources call notify() when something changes, the consumer reads sequence(), checks all sources
+    // and then waits until the sequence moves on, so a notification between the check and the wait isn't lost.
+    class WakeSignal
+    {
+    protected:
+        std::atomic<uint32_t> _sequence = 0;
+        std::atomic<uint32_t> _waiters = 0;
+
+    public:
+        uint32_t sequence() const
+        {
+            return _sequence.load(std::memory_order_acquire);
+        }
+
+        void notify()
+        {
+            _sequence.fetch_add(1, std::memory_order_seq_cst);
+
+            if (_waiters.load(std::memory_order_seq_cst) != 0)
+                atomicWakeAll(_sequence);
+        }
+
+        // Waits until the sequence differs from seen, for at most timeout (forever if it's empty), can return spuriously
+        void wait(uint32_t seen, std::optional<Time> timeout = {})
+        {
+            _waiters.fetch_add(1, std::memory_order_seq_cst);
+
+            if (_sequence.load(std::memory_order_seq_cst) == seen)
+                atomicWait(_sequence, seen, timeout);
+
+            _waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+    };
+}
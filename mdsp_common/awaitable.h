@@ -1,6 +1,10 @@
 #pragma once
-#include <memory>
+#include <optional>
+#include <utility>
+#include <coroutine>
+#include <stdexcept>
 #include "count_condition.h"
+#include "coroutine.h"
 
 namespace mdsp
 {
@@ -12,51 +16,104 @@ namespace mdsp
         static constexpr auto Timeout = CountCondition::Timeout;
         static constexpr auto Shutdown = CountCondition::Shutdown;
 
+        // Type returned to the caller of cisim::Thread::async<T> for commands deriving from this one
+        using awaitable_type = Awaitable;
+
     protected:
-        std::shared_ptr<CountCondition> done = nullptr;
+        // Intrusively counted, pooled condition shared by the caller and the command copies
+        CountCondition* done = nullptr;
 
-    public:
-        Awaitable() = default;
+        // Takes over a reference to awaiter
+        Awaitable(std::in_place_t, CountCondition* awaiter)
+            : done(awaiter)
+        {
+        }
 
-        Awaitable(size_t n)
-            : done(std::make_shared<CountCondition>())
+        void reset()
         {
-            done->expect(n);
+            if (done)
+                std::exchange(done, nullptr)->release();
         }
 
-        Awaitable(std::shared_ptr<CountCondition> awaiter)
-            : done(std::move(awaiter))
+        // co_await suspends the coroutine until the awaitable is notified or unblocked, it's resumed
+        // on the Scheduler that was current when it suspended. Suspending without one throws std::logic_error.
+        // The awaiter doesn't share ownership, so the Awaitable has to outlive the co_await expression.
+        struct Awaiter
+        {
+            CountCondition* condition = nullptr;
+
+            bool await_ready() const
+            {
+                return !condition || condition->result() != Timeout;
+            }
+
+            bool await_suspend(std::coroutine_handle<> coroutine) const
+            {
+                auto scheduler = Scheduler::current();
+
+                if (!scheduler)
+                    throw std::logic_error("co_await on Awaitable requires a current Scheduler (e.g. an Executor worker)");
+
+                return condition->suspend(coroutine, scheduler);
+            }
+
+            Result await_resume() const
+            {
+                return condition ? condition->result() : Shutdown;
+            }
+        };
+
+    public:
+        Awaitable() = default;
+
+        Awaitable(size_t n)
+            : done(CountCondition::create(n))
         {
         }
 
         ~Awaitable()
         {
-            if (done.use_count() <= 2)
+            if (done && done->references() <= 2)
                 unblock();
+
+            reset();
         }
 
-        Awaitable(const Awaitable&) = default;
+        Awaitable(const Awaitable& other)
+            : done(other.done)
+        {
+            if (done)
+                done->retain();
+        }
 
         Awaitable(Awaitable&& other) noexcept
-            : done(std::move(other.done))
+            : done(std::exchange(other.done, nullptr))
         {
-            other.done = nullptr;
         }
 
         Awaitable& operator=(const Awaitable& other)
         {
+            if (this == &other)
+                return *this;
+
             unblock();
+
             done = other.done;
 
+            if (done)
+                done->retain();
+
             return *this;
         }
 
         Awaitable& operator=(Awaitable&& other) noexcept
         {
+            if (this == &other)
+                return *this;
+
             unblock();
 
-            done = std::move(other.done);
-            other.done = nullptr;
+            done = std::exchange(other.done, nullptr);
 
             return *this;
         }
@@ -79,7 +136,7 @@ namespace mdsp
             if (done)
             {
                 done->notify();
-                done = nullptr;
+                reset();
             }
         }
 
@@ -88,16 +145,18 @@ namespace mdsp
             if (done)
             {
                 done->disable();
-                done = nullptr;
+                reset();
             }
         }
 
         Awaitable forward()
         {
-            Awaitable forwarded{ std::move(done) };
-            done = nullptr;
+            return Awaitable{ std::in_place, std::exchange(done, nullptr) };
+        }
 
-            return forwarded;
+        Awaiter operator co_await() const
+        {
+            return { done };
         }
 
         static Awaitable Empty()
@@ -114,6 +173,80 @@ namespace mdsp
         }
     };
 
+    namespace detail
+    {
+        template<typename R>
+        struct ValueCondition : CountCondition
+        {
+            std::optional<R> value;
+        };
+    }
+
+    // Awaitable carrying a result of type R from the command handler back to the caller.
+    // Handler sets the value with set(), the caller gets it with get() after wait() or as the result of co_await,
+    // an empty optional means the command was dropped (Shutdown) or the wait timed out.
+    //
+    // Example:
+    //      struct Compute : ValueAwaitable<int> { int input; };
+    //
+    //      void execute(State& state, Compute& cmd) { cmd.set(cmd.input * 2); }
+    //
+    //      std::optional<int> result = co_await thread.async<Compute>(21, 0);
+    //
+    template<typename R>
+    struct ValueAwaitable : Awaitable
+    {
+    public:
+        using awaitable_type = ValueAwaitable;
+
+    protected:
+        detail::ValueCondition<R>* state() const
+        {
+            return static_cast<detail::ValueCondition<R>*>(done);
+        }
+
+        struct ValueAwaiter : Awaiter
+        {
+            std::optional<R> await_resume() const
+            {
+                if (Awaiter::await_resume() != OK)
+                    return std::nullopt;
+
+                return std::move(static_cast<detail::ValueCondition<R>*>(condition)->value);
+            }
+        };
+
+    public:
+        ValueAwaitable() = default;
+
+        ValueAwaitable(size_t n)
+            : Awaitable(std::in_place, CountCondition::create<detail::ValueCondition<R>>(n))
+        {
+        }
+
+        // Stores the result, it has to be called before notify()
+        template<typename... Args>
+        void set(Args&&... args)
+        {
+            if (done)
+                state()->value.emplace(std::forward<Args>(args)...);
+        }
+
+        // Result set by the handler, valid after wait() returned OK
+        std::optional<R> get() const
+        {
+            if (!done || done->result() != OK)
+                return std::nullopt;
+
+            return state()->value;
+        }
+
+        ValueAwaiter operator co_await() const
+        {
+            return { { done } };
+        }
+    };
+
     template<typename T>
     constexpr bool is_awaitable = std::is_base_of_v<Awaitable, T>;
 }
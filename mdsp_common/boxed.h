@@ -0,0 +1,180 @@
+#pragma once
+#include <variant>
+#include <utility>
+#include <type_traits>
+#include <cassert>
+#include "object_pool.h"
+
+namespace mdsp
+{
+    // Owning pointer with value semantics (copies copy the value), allocated from SlabPool<T>.
+    // Used by backend::OutOfLine to keep large variant alternatives out of the queue slots.
+    // Default constructed Boxed is empty and allocates on assignment or on the first mutable access,
+    // so default constructed queue slots and variants don't take from the pool.
+    // An empty Boxed has no value to read through a const reference, const access asserts it's not empty.
+    template<typename T>
+    class Boxed
+    {
+    protected:
+        T* _value = nullptr;
+
+    public:
+        using type = T;
+
+        Boxed() = default;
+
+        Boxed(const T& value)
+            : _value(SlabPool<T>::create(value))
+        {
+        }
+
+        Boxed(T&& value)
+            : _value(SlabPool<T>::create(std::move(value)))
+        {
+        }
+
+        Boxed(const Boxed& other)
+            : _value(other._value ? SlabPool<T>::create(*other._value) : nullptr)
+        {
+        }
+
+        Boxed(Boxed&& other) noexcept
+            : _value(std::exchange(other._value, nullptr))
+        {
+        }
+
+        Boxed& operator=(Boxed other) noexcept
+        {
+            std::swap(_value, other._value);
+
+            return *this;
+        }
+
+        Boxed& operator=(const T& value)
+        {
+            if (_value)
+                *_value = value;
+            else
+                _value = SlabPool<T>::create(value);
+
+            return *this;
+        }
+
+        Boxed& operator=(T&& value)
+        {
+            if (_value)
+                *_value = std::move(value);
+            else
+                _value = SlabPool<T>::create(std::move(value));
+
+            return *this;
+        }
+
+        ~Boxed()
+        {
+            if (_value)
+                SlabPool<T>::destroy(_value);
+        }
+
+        bool empty() const
+        {
+            return _value == nullptr;
+        }
+
+        T& operator*()
+        {
+            if (!_value)
+                _value = SlabPool<T>::create();
+
+            return *_value;
+        }
+
+        const T& operator*() const
+        {
+            assert(_value && "Empty Boxed read through a const reference");
+
+            return *_value;
+        }
+
+        T* operator->() { return &**this; }
+        const T* operator->() const { return &**this; }
+    };
+
+    template<typename T>
+    T& unbox(T& value)
+    {
+        return value;
+    }
+
+    template<typename T>
+    T& unbox(Boxed<T>& value)
+    {
+        return *value;
+    }
+
+    template<typename T>
+    const T& unbox(const Boxed<T>& value)
+    {
+        return *value;
+    }
+
+    // std::visit that passes the boxed alternatives to visitor unboxed, so it sees the original types
+    template<typename Visitor, typename Variant>
+    decltype(auto) visitUnboxed(Visitor&& visitor, Variant& value)
+    {
+        return std::visit([&](auto& stored) -> decltype(auto) {
+            return visitor(unbox(stored));
+        }, value);
+    }
+
+    namespace detail
+    {
+        // std::variant with the alternatives bigger than Threshold bytes replaced by Boxed<T> (at the same index)
+        template<typename T, size_t Threshold>
+        struct Compacted
+        {
+            using type = T;
+        };
+
+        template<typename... Ts, size_t Threshold>
+        struct Compacted<std::variant<Ts...>, Threshold>
+        {
+            using type = std::variant<std::conditional_t<(sizeof(Ts) > Threshold), Boxed<Ts>, Ts>...>;
+        };
+
+        // How alternative T is stored in Stored, Boxed<T> or T itself
+        template<typename Stored, typename T>
+        struct StoredAs
+        {
+            using type = T;
+        };
+
+        template<typename... Ts, typename T>
+            requires (... || std::is_same_v<Ts, Boxed<T>>)
+        struct StoredAs<std::variant<Ts...>, T>
+        {
+            using type = Boxed<T>;
+        };
+
+        // Converts a whole variant (e.g. Commands) to the compacted one (Stored) alternative by alternative,
+        // anything Stored can be constructed from is passed through
+        template<typename Stored, typename T>
+        decltype(auto) toStored(T&& value)
+        {
+            using U = std::decay_t<T>;
+
+            if constexpr (!std::is_same_v<U, Stored> && !std::is_constructible_v<Stored, T&&> && requires { std::variant_size<U>::value; })
+            {
+                return std::visit([](auto&& alternative) {
+                    using A = std::decay_t<decltype(alternative)>;
+
+                    return Stored(std::in_place_type<typename StoredAs<Stored, A>::type>, std::forward<decltype(alternative)>(alternative));
+                }, std::forward<T>(value));
+            }
+            else
+            {
+                return std::forward<T>(value);
+            }
+        }
+    }
+}
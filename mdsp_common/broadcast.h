@@ -0,0 +1,396 @@
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <vector>
+#include <list>
+#include <utility>
+#include <algorithm>
+#include "timestamp.h"
+#include "atomic_wait.h"
+#include "sync_queue.h"
+
+namespace mdsp
+{
+    // What happens to a subscriber that falls more than the ring capacity behind the publisher
+    enum class SlowSubscriber
+    {
+        // Publisher overwrites the oldest item, the subscriber continues from the oldest retained one
+        Lag,
+        // Publisher overwrites the oldest item, the subscriber jumps to the newest one
+        SkipToLatest,
+        // Publisher waits up to publishTimeout until the slowest subscriber has read the oldest item
+        Block
+    };
+
+    struct BroadcastConfig
+    {
+        size_t capacity = 16ull;
+        SlowSubscriber policy = SlowSubscriber::Lag;
+        Time publishTimeout = 5_s;
+        Time receiveTimeout = 5_s;
+
+        [[nodiscard]]
+        constexpr BroadcastConfig withCapacity(size_t cap)
+        {
+            return BroadcastConfig{ cap, policy, publishTimeout, receiveTimeout };
+        }
+
+        [[nodiscard]]
+        constexpr BroadcastConfig withPolicy(SlowSubscriber slowSubscriber)
+        {
+            return BroadcastConfig{ capacity, slowSubscriber, publishTimeout, receiveTimeout };
+        }
+
+        [[nodiscard]]
+        constexpr BroadcastConfig withPublishTimeout(Time timeout)
+        {
+            return BroadcastConfig{ capacity, policy, timeout, receiveTimeout };
+        }
+
+        [[nodiscard]]
+        constexpr BroadcastConfig withRecvTimeout(Time timeout)
+        {
+            return BroadcastConfig{ capacity, policy, publishTimeout, timeout };
+        }
+    };
+
+    // Single ring shared by all subscribers: publish() stores the payload once as std::shared_ptr<const T>
+    // and every subscriber reads it through its own cursor, so fan-out to N consumers costs one allocation
+    // and no copies of T. Subscribers only see items published after they subscribed.
+    //
+    // The Broadcast has to outlive its subscribers.
+    //
+    // Example:
+    //      Broadcast<Frame> frames(BroadcastConfig{}.withCapacity(8).withPolicy(SlowSubscriber::SkipToLatest));
+    //      auto display = frames.subscribe();
+    //
+    //      frames.publish(Frame{ ... });                   // producer thread
+    //      auto [status, frame] = display.recv();           // consumer thread, frame is std::shared_ptr<const Frame>
+    //
+    template<typename T>
+    class Broadcast
+    {
+    public:
+        using Payload = std::shared_ptr<const T>;
+
+    protected:
+        struct Cursor
+        {
+            // Sequence number of the next item to read
+            uint64_t next = 0;
+            uint64_t missed = 0;
+        };
+
+        BroadcastConfig _config;
+
+        std::mutex _mutex;
+        std::condition_variable _published;
+        std::condition_variable _consumed;
+        size_t _blockedPublishers = 0;
+
+        std::vector<Payload> _ring;
+
+        // Sequence number of the next published item
+        uint64_t _head = 0;
+        bool _open = true;
+
+        std::list<Cursor> _cursors;
+        std::vector<WakeSignal*> _listeners;
+
+        uint64_t oldest() const
+        {
+            return _head > _ring.size() ? _head - _ring.size() : 0;
+        }
+
+        // Every subscriber has read the item the next publish overwrites
+        bool hasRoom() const
+        {
+            if (_head < _ring.size())
+                return true;
+
+            auto overwritten = _head - _ring.size();
+
+            return std::all_of(_cursors.begin(), _cursors.end(), [&](const Cursor& cursor) { return cursor.next > overwritten; });
+        }
+
+        bool readable(const Cursor& cursor) const
+        {
+            return cursor.next < _head;
+        }
+
+        Payload read(Cursor& cursor)
+        {
+            if (cursor.next < oldest())
+            {
+                auto resume = _config.policy == SlowSubscriber::SkipToLatest ? _head - 1 : oldest();
+
+                cursor.missed += resume - cursor.next;
+                cursor.next = resume;
+            }
+
+            auto payload = _ring[cursor.next % _ring.size()];
+            ++cursor.next;
+
+            return payload;
+        }
+
+        void consumed(std::unique_lock<std::mutex>& lock)
+        {
+            bool blocked = _blockedPublishers != 0;
+
+            lock.unlock();
+
+            if (blocked)
+                _consumed.notify_all();
+        }
+
+    public:
+        // Receiving end with its own read position, move-only, unsubscribes on destruction
+        // Like SyncQueue it can be added to a WaitSet (value_type is the shared payload)
+        class Subscriber
+        {
+        protected:
+            friend class Broadcast;
+
+            Broadcast* _channel = nullptr;
+            typename std::list<Cursor>::iterator _cursor;
+
+            Subscriber(Broadcast& channel, typename std::list<Cursor>::iterator cursor)
+                : _channel(&channel)
+                , _cursor(cursor)
+            {
+            }
+
+        public:
+            using value_type = Payload;
+
+            Subscriber() = default;
+
+            Subscriber(Subscriber&& other) noexcept
+                : _channel(std::exchange(other._channel, nullptr))
+                , _cursor(other._cursor)
+            {
+            }
+
+            Subscriber& operator=(Subscriber&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    unsubscribe();
+
+                    _channel = std::exchange(other._channel, nullptr);
+                    _cursor = other._cursor;
+                }
+
+                return *this;
+            }
+
+            ~Subscriber()
+            {
+                unsubscribe();
+            }
+
+            void unsubscribe()
+            {
+                if (_channel)
+                    std::exchange(_channel, nullptr)->remove(_cursor);
+            }
+
+            // Waits up to timeout for the next item, Shutdown once the broadcast is closed and everything was read
+            std::pair<SyncQStatus, Payload> recv(Time timeout)
+            {
+                return _channel->receive(*_cursor, timeout);
+            }
+
+            std::pair<SyncQStatus, Payload> recv()
+            {
+                return recv(_channel->receiveTimeout());
+            }
+
+            bool poll(Payload& payload)
+            {
+                auto [status, item] = _channel->receive(*_cursor, Time::Zero());
+
+                if (status != SyncQStatus::OK)
+                    return false;
+
+                payload = std::move(item);
+                return true;
+            }
+
+            // Number of items skipped because this subscriber fell behind
+            uint64_t missed()
+            {
+                std::unique_lock lock{ _channel->_mutex };
+
+                return _cursor->missed;
+            }
+
+            // Number of published items this subscriber hasn't read yet (including the ones it's going to miss)
+            size_t size()
+            {
+                std::unique_lock lock{ _channel->_mutex };
+
+                return size_t(_channel->_head - _cursor->next);
+            }
+
+            bool isEmpty()
+            {
+                return size() == 0;
+            }
+
+            bool shouldReceive()
+            {
+                std::unique_lock lock{ _channel->_mutex };
+
+                return _channel->_open;
+            }
+
+            void attach(WakeSignal& listener)
+            {
+                _channel->attach(listener);
+            }
+
+            void detach(WakeSignal& listener)
+            {
+                _channel->detach(listener);
+            }
+        };
+
+        explicit Broadcast(const BroadcastConfig& config = {})
+            : _config(config)
+            , _ring((std::max)(config.capacity, size_t(1)))
+        {
+        }
+
+        Broadcast(const Broadcast&) = delete;
+        Broadcast& operator=(const Broadcast&) = delete;
+
+        Subscriber subscribe()
+        {
+            std::unique_lock lock{ _mutex };
+
+            auto cursor = _cursors.insert(_cursors.end(), Cursor{ _head, 0 });
+
+            return Subscriber(*this, cursor);
+        }
+
+        // Returns false if the broadcast is closed, or with SlowSubscriber::Block when a subscriber
+        // didn't make room within publishTimeout
+        bool publish(Payload payload)
+        {
+            std::unique_lock lock{ _mutex };
+
+            if (_config.policy == SlowSubscriber::Block && !hasRoom())
+            {
+                ++_blockedPublishers;
+
+                bool ready = _consumed.wait_until(lock, deadlineAfter(_config.publishTimeout), [&]() { return !_open || hasRoom(); });
+
+                --_blockedPublishers;
+
+                if (!ready)
+                    return false;
+            }
+
+            if (!_open)
+                return false;
+
+            _ring[_head % _ring.size()] = std::move(payload);
+            ++_head;
+
+            for (auto* listener : _listeners)
+                listener->notify();
+
+            lock.unlock();
+            _published.notify_all();
+
+            return true;
+        }
+
+        bool publish(T value)
+        {
+            return publish(std::make_shared<const T>(std::move(value)));
+        }
+
+        // Wakes up all subscribers, they can still read what was published before
+        void close()
+        {
+            std::unique_lock lock{ _mutex };
+
+            _open = false;
+
+            for (auto* listener : _listeners)
+                listener->notify();
+
+            lock.unlock();
+            _published.notify_all();
+            _consumed.notify_all();
+        }
+
+        Time receiveTimeout()
+        {
+            std::unique_lock lock{ _mutex };
+
+            return _config.receiveTimeout;
+        }
+
+        // Total number of published items
+        uint64_t published()
+        {
+            std::unique_lock lock{ _mutex };
+
+            return _head;
+        }
+
+        size_t subscribers()
+        {
+            std::unique_lock lock{ _mutex };
+
+            return _cursors.size();
+        }
+
+    protected:
+        std::pair<SyncQStatus, Payload> receive(Cursor& cursor, Time timeout)
+        {
+            std::unique_lock lock{ _mutex };
+
+            if (!readable(cursor) && timeout > Time::Zero())
+                _published.wait_until(lock, deadlineAfter(timeout), [&]() { return readable(cursor) || !_open; });
+
+            if (!readable(cursor))
+                return { _open ? SyncQStatus::Timeout : SyncQStatus::Shutdown, nullptr };
+
+            auto payload = read(cursor);
+
+            consumed(lock);
+
+            return { SyncQStatus::OK, std::move(payload) };
+        }
+
+        void remove(typename std::list<Cursor>::iterator cursor)
+        {
+            std::unique_lock lock{ _mutex };
+
+            _cursors.erase(cursor);
+
+            // The slowest subscriber may be gone
+            consumed(lock);
+        }
+
+        void attach(WakeSignal& listener)
+        {
+            std::unique_lock lock{ _mutex };
+
+            _listeners.push_back(&listener);
+        }
+
+        void detach(WakeSignal& listener)
+        {
+            std::unique_lock lock{ _mutex };
+
+            std::erase(_listeners, &listener);
+        }
+    };
+}
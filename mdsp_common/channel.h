@@ -1,7 +1,12 @@
 #pragma once
 #include <type_traits>
+#include <memory>
+#include <iterator>
+#include <ranges>
+#include <vector>
 #include "timestamp.h"
 #include "sync_queue.h"
+#include "queue_backend.h"
 #include "awaitable.h"
 
 namespace mdsp
@@ -12,22 +17,42 @@ namespace mdsp
         Time consumerTimeout = 5_s;
         size_t capacity = 10ull;
 
+        // Receivers busy-wait according to this policy before blocking, by default they block right away
+        SpinPolicy receiveSpin = {};
+
+        // What send does when the channel is full
+        Overflow overflow = Overflow::Block;
+
         [[nodiscard]]
         constexpr ChannelConfig withSendTimeout(Time timeout)
         {
-            return ChannelConfig{ timeout, consumerTimeout, capacity };
+            return ChannelConfig{ timeout, consumerTimeout, capacity, receiveSpin, overflow };
         }
 
         [[nodiscard]]
         constexpr ChannelConfig withRecvTimeout(Time timeout)
         {
-            return ChannelConfig{ producerTimeout, timeout, capacity };
+            return ChannelConfig{ producerTimeout, timeout, capacity, receiveSpin, overflow };
         }
 
         [[nodiscard]]
         constexpr ChannelConfig withCapacity(size_t cap)
         {
-            return ChannelConfig{ producerTimeout, consumerTimeout, cap };
+            return ChannelConfig{ producerTimeout, consumerTimeout, cap, receiveSpin, overflow };
+        }
+
+        // Low-latency receive: poll spins times (or for budget, whichever lasts longer), then yield yields times, then block
+        [[nodiscard]]
+        constexpr ChannelConfig withRecvSpin(size_t spins, Time budget = Time::Zero(), size_t yields = 0)
+        {
+            return ChannelConfig{ producerTimeout, consumerTimeout, capacity, SpinPolicy{ spins, budget, yields }, overflow };
+        }
+
+        // For producers that must never stall behind a slow consumer use Reject, DropOldest or DropNewest
+        [[nodiscard]]
+        constexpr ChannelConfig withOverflow(Overflow policy)
+        {
+            return ChannelConfig{ producerTimeout, consumerTimeout, capacity, receiveSpin, policy };
         }
     };
 
@@ -35,35 +60,93 @@ namespace mdsp
     {
         struct Serial
         {
-            template<typename T, typename U>
-            void operator()(SyncQueue<T>& q, U&& req)
+            template<typename Q, typename U>
+            void operator()(Q& q, U&& req)
             {
                 q.add(std::forward<U>(req));
             }
+
+            template<typename Q, typename It>
+            size_t operator()(Q& q, It first, It last)
+            {
+                return q.addBulk(first, last);
+            }
         };
 
         struct Priority
         {
-            template<typename T, typename U>
-            void operator()(SyncQueue<T>& q, U&& req)
+            template<typename Q, typename U>
+            void operator()(Q& q, U&& req)
             {
+                static_assert(requires { q.addFront(std::forward<U>(req)); },
+                    "Queue backend doesn't support front insertion, Priority dispatch can't be used with it");
+
                 q.addFront(std::forward<U>(req));
             }
+
+            template<typename Q, typename It>
+            size_t operator()(Q& q, It first, It last)
+            {
+                static_assert(requires { q.addFrontBulk(first, last); },
+                    "Queue backend doesn't support front insertion, Priority dispatch can't be used with it");
+
+                return q.addFrontBulk(first, last);
+            }
+        };
+
+        // Sends to the given lane of a queue with PriorityLanes storage (backend::Lanes)
+        template<size_t Index>
+        struct Lane
+        {
+            template<typename Q, typename U>
+            void operator()(Q& q, U&& req)
+            {
+                q.addTo(Index, std::forward<U>(req));
+            }
+
+            template<typename Q, typename It>
+            size_t operator()(Q& q, It first, It last)
+            {
+                return q.addBulkTo(Index, first, last);
+            }
         };
     };
 
-    template<typename Messages>
+    template<typename Messages, typename Backend = backend::Mutex>
     struct Channel
     {
         using type = Messages;
+        using Queue = typename Backend::template Queue<Messages>;
 
-        SyncQueue<Messages> q;
+        // How message type T is stored in the queue, Boxed<T> with backend::OutOfLine for large alternatives
+        template<typename T>
+        using Stored = typename detail::StoredAs<typename Queue::value_type, std::decay_t<T>>::type;
+
+        Queue q;
 
         auto recv()
         {
             return q.getWithStatus();
         }
 
+        auto recv(Time timeout)
+        {
+            return q.getWithStatus(timeout);
+        }
+
+        // Receives up to maxN messages in one wakeup, returns the status and the number of received messages
+        template<typename OutputIt>
+        auto recvBatch(OutputIt out, size_t maxN)
+        {
+            return q.getBulk(out, maxN);
+        }
+
+        template<typename OutputIt>
+        auto recvBatch(OutputIt out, size_t maxN, Time timeout)
+        {
+            return q.getBulk(out, maxN, timeout);
+        }
+
         bool empty()
         {
             return q.isEmpty();
@@ -77,7 +160,37 @@ namespace mdsp
         template<typename Dispatch = dispatch::Serial, typename T>
         void send(T&& msg)
         {
-            Dispatch{}(q, std::forward<T>(msg));
+            Dispatch{}(q, detail::toStored<typename Queue::value_type>(std::forward<T>(msg)));
+        }
+
+        // Sends the whole range with a single consumer wakeup, messages are moved out of rvalue ranges
+        // Returns the number of accepted messages, the rest didn't fit within producerTimeout or the channel was closed
+        template<typename Dispatch = dispatch::Serial, std::ranges::forward_range R>
+            requires std::ranges::common_range<R>
+        size_t sendBatch(R&& msgs)
+        {
+            using Stored = typename Queue::value_type;
+
+            // Messages with boxed alternatives (backend::OutOfLine) are converted up front
+            if constexpr (!std::is_constructible_v<Stored, std::ranges::range_reference_t<R>>)
+            {
+                std::vector<Stored> stored;
+                stored.reserve(std::ranges::distance(msgs));
+
+                for (auto&& msg : msgs)
+                {
+                    if constexpr (std::is_rvalue_reference_v<R&&>)
+                        stored.push_back(detail::toStored<Stored>(std::move(msg)));
+                    else
+                        stored.push_back(detail::toStored<Stored>(msg));
+                }
+
+                return Dispatch{}(q, std::make_move_iterator(stored.begin()), std::make_move_iterator(stored.end()));
+            }
+            else if constexpr (std::is_rvalue_reference_v<R&&>)
+                return Dispatch{}(q, std::make_move_iterator(std::ranges::begin(msgs)), std::make_move_iterator(std::ranges::end(msgs)));
+            else
+                return Dispatch{}(q, std::ranges::begin(msgs), std::ranges::end(msgs));
         }
 
         void open(const ChannelConfig& config)
@@ -85,40 +198,76 @@ namespace mdsp
             q.producerTimeout(config.producerTimeout);
             q.consumerTimeout(config.consumerTimeout);
             q.capacity(config.capacity);
+            q.receiveSpin(config.receiveSpin);
+            q.overflow(config.overflow);
             q.shouldReceive(true);
         }
 
-        void close()
+        // Queued messages are dropped, unless shouldClear is false, then they can still be received
+        // and recv returns Shutdown once the channel is empty
+        void close(ClearCache shouldClear = ClearCache(true))
         {
-            q.lock()
-                .deny()
-                .clear(true)
-                .notifyAll();
+            q.shouldReceive(false, shouldClear);
         }
 
         template<typename T, typename F>
         void select(F&& handler)
         {
-            q.template forEach<std::decay_t<T>>(std::forward<F>(handler));
+            if constexpr (std::is_same_v<Stored<T>, std::decay_t<T>>)
+                q.template forEach<std::decay_t<T>>(std::forward<F>(handler));
+            else
+                q.template forEach<Stored<T>>([&](auto& boxed) { handler(unbox(boxed)); });
         }
 
+        // Replaces the queued messages of the same type with value (keeping their position), or sends it if there are none
+        // With backend::Coalescing only the newest queued message of that type is looked up and replaced, in O(1)
         template<typename Dispatch = dispatch::Serial, typename T>
         void update(T&& value)
         {
+            using U = std::decay_t<T>;
+
             bool updated = false;
 
-            select<std::decay_t<T>>([&](auto&& existing) {
-                if constexpr (is_awaitable<std::decay_t<T>>)
-                    existing.unblock();
+            auto replace = [&](auto&& existing) {
+                auto& target = unbox(existing);
+
+                if constexpr (is_awaitable<U>)
+                    target.unblock();
 
-                existing = std::forward<T>(value);
+                target = std::forward<T>(value);
                 updated = true;
-            });
+            };
+
+            if constexpr (requires { q.template latest<Stored<U>>(replace); })
+                q.template latest<Stored<U>>(replace);
+            else
+                select<U>(replace);
 
             if (!updated)
                 send<Dispatch>(std::forward<T>(value));
         }
 
+        // Makes the receiver blocked in recv/recvBatch return Timeout early, e.g. when it has to wait for a shorter time
+        void interrupt()
+        {
+            q.interrupt();
+        }
+
+        // Depth, latency, blocking and timeout statistics of the channel queue, readable from any thread without locking
+        auto metrics()
+        {
+            static_assert(requires { q.metrics(); },
+                "Channel backend doesn't record metrics, use backend::Instrumented<Base>");
+
+            return q.metrics();
+        }
+
+        // Items rejected or dropped because the channel was full
+        OverflowCounters overflowCounters()
+        {
+            return q.overflowCounters();
+        }
+
         void clear()
         {
             q.clear();
@@ -127,13 +276,19 @@ namespace mdsp
         template<typename... Ts>
         void remove()
         {
-            q.template remove<Ts...>();
+            q.template remove<Stored<Ts>...>();
+        }
+
+        template<typename... Ts>
+        size_t count()
+        {
+            return q.template count<Stored<Ts>...>();
         }
     };
 
-    template<typename Commands>
-    using RefChannel = Channel<Commands>&;
+    template<typename Commands, typename Backend = backend::Mutex>
+    using RefChannel = Channel<Commands, Backend>&;
 
-    template<typename Commands>
-    using SharedChannel = std::shared_ptr<Channel<Commands>>;
+    template<typename Commands, typename Backend = backend::Mutex>
+    using SharedChannel = std::shared_ptr<Channel<Commands, Backend>>;
 }
@@ -0,0 +1,186 @@
+#pragma once
+#include <array>
+#include <deque>
+#include <variant>
+#include <limits>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include "meta.h"
+
+namespace mdsp
+{
+    // SyncQueue storage adapter for std::variant items that remembers where the newest item of each alternative is.
+    // Storage has to be random access (std::deque, RingBuffer).
+    //
+    // Every stored item gets a sequence number, front item has _head sequence number, so the position
+    // of an item is its sequence number - _head. Index of the newest item of each alternative is kept up to date
+    // on push/pop, which makes latest<U>() O(1). Erasing from the middle renumbers the items and rebuilds the index.
+    //
+    // Items must not be changed to a different alternative in place (e.g. through iteration), since the index wouldn't notice it.
+    template<typename T, typename Storage = std::deque<T>>
+    class CoalescingIndex
+    {
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using iterator = typename Storage::iterator;
+        using const_iterator = typename Storage::const_iterator;
+
+    protected:
+        static constexpr uint64_t npos = std::numeric_limits<uint64_t>::max();
+
+        // Sequence number of the front item of an empty queue, in the middle of the range so that
+        // front insertions never wrap around to npos
+        static constexpr uint64_t origin = 1ull << 63;
+        static constexpr size_t alternatives = std::variant_size_v<T>;
+
+        Storage _q;
+        uint64_t _head = origin;
+        std::array<uint64_t, alternatives> _latest;
+
+        void rebuild()
+        {
+            _head = origin;
+            _latest.fill(npos);
+
+            for (size_t i = 0; i < _q.size(); ++i)
+                _latest[_q[i].index()] = _head + i;
+        }
+
+        void pushedBack()
+        {
+            _latest[_q.back().index()] = _head + _q.size() - 1;
+        }
+
+        void pushedFront()
+        {
+            --_head;
+
+            auto& latest = _latest[_q.front().index()];
+
+            if (latest == npos)
+                latest = _head;
+        }
+
+    public:
+        CoalescingIndex()
+        {
+            _latest.fill(npos);
+        }
+
+        size_t size() const { return _q.size(); }
+        bool empty() const { return _q.empty(); }
+
+        void reserve(size_t capacity)
+        {
+            if constexpr (requires { _q.reserve(capacity); })
+                _q.reserve(capacity);
+        }
+
+        T& operator[](size_t index) { return _q[index]; }
+        const T& operator[](size_t index) const { return _q[index]; }
+
+        T& front() { return _q.front(); }
+        const T& front() const { return _q.front(); }
+        T& back() { return _q.back(); }
+        const T& back() const { return _q.back(); }
+
+        iterator begin() { return _q.begin(); }
+        iterator end() { return _q.end(); }
+        const_iterator begin() const { return _q.begin(); }
+        const_iterator end() const { return _q.end(); }
+
+        // Newest stored item holding U alternative, nullptr if there's none
+        template<typename U>
+        U* latest()
+        {
+            auto seq = _latest[meta::IndexOf<T, U>::value];
+
+            if (seq == npos)
+                return nullptr;
+
+            return std::get_if<U>(&_q[size_t(seq - _head)]);
+        }
+
+        template<typename... Args>
+        T& emplace_back(Args&&... args)
+        {
+            auto& item = _q.emplace_back(std::forward<Args>(args)...);
+            pushedBack();
+
+            return item;
+        }
+
+        template<typename... Args>
+        T& emplace_front(Args&&... args)
+        {
+            auto& item = _q.emplace_front(std::forward<Args>(args)...);
+            pushedFront();
+
+            return item;
+        }
+
+        void push_back(T item) { emplace_back(std::move(item)); }
+        void push_front(T item) { emplace_front(std::move(item)); }
+
+        void pop_front()
+        {
+            auto& latest = _latest[_q.front().index()];
+
+            if (latest == _head)
+                latest = npos;
+
+            _q.pop_front();
+            ++_head;
+        }
+
+        template<typename It>
+        iterator insert(const_iterator pos, It first, It last)
+        {
+            bool front = pos == const_iterator(_q.begin());
+            size_t count = size_t(std::distance(first, last));
+
+            auto it = _q.insert(pos, first, last);
+
+            if (!front)
+            {
+                rebuild();
+                return it;
+            }
+
+            _head -= count;
+
+            for (size_t i = count; i > 0; --i)
+            {
+                auto& latest = _latest[_q[i - 1].index()];
+
+                if (latest == npos)
+                    latest = _head + i - 1;
+            }
+
+            return it;
+        }
+
+        template<typename Predicate>
+        size_t erase_if(Predicate&& predicate)
+        {
+            auto it = std::remove_if(_q.begin(), _q.end(), std::ref(predicate));
+            auto count = size_t(std::distance(it, _q.end()));
+
+            _q.erase(it, _q.end());
+            rebuild();
+
+            return count;
+        }
+
+        void clear()
+        {
+            _q.clear();
+
+            _head = origin;
+            _latest.fill(npos);
+        }
+    };
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+
+namespace mdsp
+{
+    // Place where coroutines suspended on co_await Awaitable are resumed.
+    // A thread that runs a scheduler (e.g. cisim::Executor worker) makes it current for itself,
+    // coroutines awaiting from that thread are then posted back to it on completion.
+    // co_await Awaitable requires a current scheduler (it throws std::logic_error without one), otherwise
+    // the rest of the coroutine would run inside notify() on the thread that completed the Awaitable.
+    class Scheduler
+    {
+    protected:
+        static inline thread_local Scheduler* _active = nullptr;
+
+        static void makeCurrent(Scheduler* scheduler)
+        {
+            _active = scheduler;
+        }
+
+    public:
+        virtual ~Scheduler()
+        {}
+
+        virtual void post(std::coroutine_handle<> coroutine) = 0;
+
+        static Scheduler* current()
+        {
+            return _active;
+        }
+
+        static void resume(Scheduler* scheduler, std::coroutine_handle<> coroutine)
+        {
+            if (scheduler)
+                scheduler->post(coroutine);
+            else
+                coroutine.resume();
+        }
+    };
+
+    // Fire-and-forget coroutine, it starts immediately and frees itself when it finishes
+    // It has to be started on a thread with a current Scheduler (e.g. from an Actor command) to co_await Awaitables
+    //
+    // Example:
+    //      Task request(Worker& worker)
+    //      {
+    //          auto result = co_await worker.async<Compute>(42, 0);
+    //          ...
+    //      }
+    //
+    struct Task
+    {
+        struct promise_type
+        {
+            Task get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+}
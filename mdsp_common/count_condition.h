@@ -1,20 +1,24 @@
 #pragma once
-#include <mutex>
-#include <condition_variable>
+#include <atomic>
+#include <chrono>
 #include <optional>
+#include <coroutine>
+#include <cstdint>
+#include <utility>
 #include "timestamp.h"
+#include "coroutine.h"
+#include "atomic_wait.h"
+#include "object_pool.h"
 
 namespace mdsp
 {
+    // Completes after expected number of notify() calls or when it's disabled.
+    // The whole state (remaining count + flags) is a single atomic word: notify/disable are one atomic RMW
+    // and only make a syscall when a thread is actually blocked in wait().
+    // Conditions made by create() are reference counted (retain/release) and their memory is pooled in SlabPool:
+    // the caller usually creates them and the worker releases them last, a per-thread pool would keep allocating.
     class CountCondition
     {
-    protected:
-        bool _enabled = false;
-        size_t _count = 0;
-        size_t _expectedCount = 0;
-        std::mutex _mutex;
-        std::condition_variable _var;
-
     public:
         enum class Result
         {
@@ -27,60 +31,172 @@ namespace mdsp
         static constexpr auto Shutdown = Result::Shutdown;
         static constexpr auto Timeout = Result::Timeout;
 
-        bool disable()
+    protected:
+        static constexpr uint32_t Disabled = uint32_t(1) << 31;
+        static constexpr uint32_t Waiting = uint32_t(1) << 30;
+        static constexpr uint32_t Suspended = uint32_t(1) << 29;
+        static constexpr uint32_t CountMask = Suspended - 1;
+
+        // Remaining notifications and Disabled/Waiting/Suspended flags
+        std::atomic<uint32_t> _state = 0;
+        std::atomic<uint32_t> _references = 1;
+        void (*_recycle)(CountCondition*) = nullptr;
+
+        // Coroutine suspended in co_await, resumed once the condition is done or disabled
+        std::coroutine_handle<> _continuation = nullptr;
+        Scheduler* _scheduler = nullptr;
+
+        static bool finished(uint32_t state)
+        {
+            return (state & Disabled) || (state & CountMask) == 0;
+        }
+
+        static Result resultOf(uint32_t state)
+        {
+            if (state & Disabled)
+                return Result::Shutdown;
+
+            return (state & CountMask) == 0 ? Result::OK : Result::Timeout;
+        }
+
+        // Called once by whoever finished the condition, old is the state before that
+        void finish(uint32_t old)
+        {
+            if (old & Waiting)
+                atomicWakeAll(_state);
+
+            if (old & Suspended)
+                Scheduler::resume(_scheduler, std::exchange(_continuation, nullptr));
+        }
+
+    public:
+        CountCondition() = default;
+
+        CountCondition(const CountCondition&) = delete;
+        CountCondition& operator=(const CountCondition&) = delete;
+
+        // Pooled condition (Condition is CountCondition or derived from it) expecting n notifications,
+        // it holds one reference and returns to the pool after the last release()
+        template<typename Condition = CountCondition>
+        static Condition* create(size_t expectedCount)
+        {
+            Condition* condition = SlabPool<Condition>::create();
+            CountCondition* base = condition;
+
+            base->_recycle = [](CountCondition* self) {
+                SlabPool<Condition>::destroy(static_cast<Condition*>(self));
+            };
+
+            base->expect(expectedCount);
+
+            return condition;
+        }
+
+        void retain()
         {
-            std::unique_lock lock{ _mutex };
+            _references.fetch_add(1, std::memory_order_relaxed);
+        }
 
-            if (!_enabled)
-                return false;
+        void release()
+        {
+            if (_references.fetch_sub(1, std::memory_order_acq_rel) == 1 && _recycle)
+                _recycle(this);
+        }
 
-            _enabled = false;
-            lock.unlock();
+        uint32_t references() const
+        {
+            return _references.load(std::memory_order_acquire);
+        }
+
+        // Finishes the condition with Shutdown, returns false if it has already finished
+        bool disable()
+        {
+            auto state = _state.load(std::memory_order_relaxed);
+
+            do
+            {
+                if (finished(state))
+                    return false;
+            }
+            while (!_state.compare_exchange_weak(state, state | Disabled, std::memory_order_acq_rel));
 
-            _var.notify_all();
+            finish(state);
             return true;
         }
 
         void expect(size_t expectedCount)
         {
-            std::lock_guard lock{ _mutex };
-
-            _enabled = true;
-            _count = 0;
-            _expectedCount = expectedCount;
+            _state.store(uint32_t(expectedCount) & CountMask, std::memory_order_release);
         }
 
+        // Notifications beyond the expected count are ignored
         void notify()
         {
-            std::unique_lock lock{ _mutex };
+            auto state = _state.load(std::memory_order_relaxed);
 
-            ++_count;
-            lock.unlock();
+            do
+            {
+                if (finished(state))
+                    return;
+            }
+            while (!_state.compare_exchange_weak(state, state - 1, std::memory_order_acq_rel));
 
-            _var.notify_all();
+            if (finished(state - 1))
+                finish(state);
+        }
+
+        // Registers coroutine to be resumed through scheduler (inline if it's nullptr) once the condition is done,
+        // returns false without registering if it's already done. Only one coroutine can be suspended at a time.
+        bool suspend(std::coroutine_handle<> continuation, Scheduler* scheduler)
+        {
+            _continuation = continuation;
+            _scheduler = scheduler;
+
+            auto state = _state.load(std::memory_order_relaxed);
+
+            do
+            {
+                if (finished(state))
+                    return false;
+            }
+            while (!_state.compare_exchange_weak(state, state | Suspended, std::memory_order_acq_rel));
+
+            return true;
+        }
+
+        // Non-blocking wait(), Timeout means it's not done yet
+        Result result() const
+        {
+            return resultOf(_state.load(std::memory_order_acquire));
         }
 
         Result wait(std::optional<Time> timeout = {})
         {
-            auto shouldWait = [&]() {
-                return _enabled && _count != _expectedCount;
-            };
+            auto start = std::chrono::steady_clock::now();
+            auto state = _state.load(std::memory_order_acquire);
+
+            while (!finished(state))
+            {
+                if (!(state & Waiting) && !_state.compare_exchange_weak(state, state | Waiting, std::memory_order_acq_rel))
+                    continue;
 
-            std::unique_lock lock{ _mutex };
+                state |= Waiting;
 
-            if (_expectedCount == 0)
-                return Result::OK;
+                std::optional<Time> remaining;
 
-            bool timedout = false;
-            auto waitTime = timeout.value_or(Time::FromSeconds(INT_MAX));
+                if (timeout)
+                {
+                    remaining = *timeout - Time(std::chrono::steady_clock::now() - start);
 
-            if (shouldWait())
-                timedout = !_var.wait_for(lock, waitTime.chronoMilliseconds(), [&]() { return !shouldWait(); });
+                    if (*remaining <= Time::Zero())
+                        return Result::Timeout;
+                }
 
-            if (!_enabled || timedout)
-                return !_enabled ? Result::Shutdown : Result::Timeout;
+                atomicWait(_state, state, remaining);
+                state = _state.load(std::memory_order_acquire);
+            }
 
-            return Result::OK;
+            return resultOf(state);
         }
     };
 }
@@ -0,0 +1,607 @@
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <utility>
+#include <type_traits>
+#include <vector>
+#include <limits>
+#include <iterator>
+#include <chrono>
+#include <concurrentqueue/moodycamel/concurrentqueue.h>
+#include <readerwriterqueue/readerwriterqueue.h>
+#include "timestamp.h"
+#include "atomic_wait.h"
+#include "sync_queue.h"
+
+#undef min
+#undef max
+
+namespace mdsp
+{
+    // SyncQueue counterpart built on top of moodycamel lock-free queues.
+    // Items are exchanged without taking a lock, the mutex is only used to park producers/consumers
+    // when the queue is full/empty, and it's only touched by the other side when someone is actually parked.
+    //
+    // Queue has to provide enqueue(T&&), try_dequeue(T&) and size_approx() (moodycamel::ReaderWriterQueue
+    // for single producer/single consumer, moodycamel::ConcurrentQueue for multiple producers/consumers).
+    //
+    // Capacity, producer/consumer timeouts, shouldReceive and the overflow policy behave the same as in SyncQueue.
+    // clear() and shouldReceive(false, ClearCache(true)) dequeue and destroy the queued items on the calling thread,
+    // with moodycamel::ReaderWriterQueue (single consumer) they mustn't run concurrently with the consumer.
+    // ReaderWriterQueue producers can't dequeue either, so Overflow::DropOldest drops the new item there (as DropNewest).
+    // Front insertion, iteration and selective removal aren't supported, since lock-free queues can't provide them.
+    template<typename T, typename Queue>
+    class LockFreeQueue
+    {
+    public:
+        using value_type = T;
+
+    protected:
+        std::atomic<Time> _producerTimeout = Time::FromSeconds(std::numeric_limits<int>::max());
+        std::atomic<Time> _consumerTimeout = Time::FromSeconds(5);
+        std::atomic<size_t> _capacity;
+        std::atomic<bool> _shouldReceive;
+        std::atomic<Overflow> _overflow = Overflow::Block;
+
+        std::atomic<uint64_t> _rejected = 0;
+        std::atomic<uint64_t> _droppedOldest = 0;
+        std::atomic<uint64_t> _droppedNewest = 0;
+
+        // Receive SpinPolicy fields, kept separately so that they stay lock-free
+        std::atomic<size_t> _spins = 0;
+        std::atomic<Time> _spinBudget = Time::Zero();
+        std::atomic<size_t> _yields = 0;
+
+        // Number of enqueued items, slots are reserved by producers before the item is enqueued,
+        // so capacity is never exceeded and the count never underflows
+        std::atomic<size_t> _size = 0;
+
+        std::mutex _mutex;
+        std::condition_variable _notFull;
+        std::condition_variable _notEmpty;
+        std::atomic<size_t> _waitingProducers = 0;
+        std::atomic<size_t> _waitingConsumers = 0;
+
+        // Signals of WaitSets waiting on this queue (guarded by _mutex), notified whenever items are added or the queue is closed
+        std::vector<WakeSignal*> _listeners;
+        std::atomic<size_t> _listenerCount = 0;
+
+        // Set by interrupt(), makes the current (or next) consumer wait return early
+        std::atomic_bool _interrupted = false;
+
+        Queue _q;
+
+        // Only the consumer side of moodycamel::ReaderWriterQueue may dequeue
+        static constexpr bool SingleConsumer = std::is_same_v<Queue, moodycamel::ReaderWriterQueue<T>>;
+
+        size_t _size_impl() const
+        {
+            return _size.load();
+        }
+
+        bool _isFull_impl() const
+        {
+            auto capacity = _capacity.load(std::memory_order_relaxed);
+
+            if (capacity == 0)
+                return false;
+
+            return _size_impl() >= capacity;
+        }
+
+        // Claims up to count free slots, returns the number of claimed ones
+        size_t reserve(size_t count)
+        {
+            auto capacity = _capacity.load(std::memory_order_relaxed);
+
+            if (capacity == 0)
+            {
+                _size.fetch_add(count);
+                return count;
+            }
+
+            auto size = _size.load();
+
+            while (size < capacity)
+            {
+                auto claimed = std::min(count, capacity - size);
+
+                if (_size.compare_exchange_weak(size, size + claimed))
+                    return claimed;
+            }
+
+            return 0;
+        }
+
+        bool pop(T& item)
+        {
+            if (!_q.try_dequeue(item))
+                return false;
+
+            _size.fetch_sub(1);
+
+            return true;
+        }
+
+        // Enqueues an item into a slot claimed with reserve/makeRoom
+        void push(T&& item)
+        {
+            _q.enqueue(std::move(item));
+
+            pushed();
+        }
+
+        // Dequeues and destroys the items queued when it was called
+        void discardQueued()
+        {
+            size_t discarded = 0;
+
+            for (auto count = _size.load(); discarded < count; ++discarded)
+            {
+                T item;
+
+                if (!pop(item))
+                    break;
+            }
+
+            if (discarded > 0)
+                popped(discarded);
+        }
+
+        void notifyListeners()
+        {
+            std::lock_guard lock{ _mutex };
+
+            for (auto* listener : _listeners)
+                listener->notify();
+        }
+
+        void pushed(size_t count = 1)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (count == 0)
+                return;
+
+            if (_listenerCount.load() != 0)
+                notifyListeners();
+
+            if (_waitingConsumers.load() == 0)
+                return;
+
+            if (count > 1)
+                notifyConsumers();
+            else
+                notifyConsumer();
+        }
+
+        void popped(size_t count = 1)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (_waitingProducers.load() == 0)
+                return;
+
+            if (count > 1)
+                notifyProducers();
+            else
+                notifyProducer();
+        }
+
+        // Waits until a slot is claimed, the deadline passes or the queue stops receiving
+        bool waitReserve(std::chrono::steady_clock::time_point deadline)
+        {
+            std::unique_lock lock{ _mutex };
+
+            _waitingProducers.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // A claimed slot belongs to the caller even if the queue stops receiving meanwhile,
+            // returning false would leak it
+            bool claimed = false;
+
+            _notFull.wait_until(lock, deadline, [&]() { return !_shouldReceive || (claimed = reserve(1) == 1); });
+
+            _waitingProducers.fetch_sub(1);
+
+            return claimed;
+        }
+
+        // Claims a slot for a new item, applying the overflow policy to a full queue
+        // Returns false if the new item mustn't be added, Overflow::Block only waits if mayBlock is set
+        bool makeRoom(bool mayBlock = true)
+        {
+            if (reserve(1) == 1)
+                return true;
+
+            auto overflow = _overflow.load();
+
+            // The dropped item's slot is handed over to the new one
+            if (overflow == Overflow::DropOldest && (dropOldest() || reserve(1) == 1))
+                return true;
+
+            if (overflow == Overflow::Block && mayBlock && waitReserve(deadlineAfter(_producerTimeout)))
+                return true;
+
+            refuse(1);
+
+            return false;
+        }
+
+        // Dequeues and destroys the oldest item, its slot stays claimed
+        bool dropOldest()
+        {
+            if constexpr (SingleConsumer)
+            {
+                return false;
+            }
+            else
+            {
+                T item;
+
+                if (!_q.try_dequeue(item))
+                    return false;
+
+                _droppedOldest.fetch_add(1, std::memory_order_relaxed);
+
+                return true;
+            }
+        }
+
+        // The new item is dropped rather than rejected (add returns true)
+        bool dropsNewest() const
+        {
+            auto overflow = _overflow.load();
+
+            return overflow == Overflow::DropNewest || (SingleConsumer && overflow == Overflow::DropOldest);
+        }
+
+        void refuse(size_t count)
+        {
+            if (dropsNewest())
+                _droppedNewest.fetch_add(count, std::memory_order_relaxed);
+            else
+                _rejected.fetch_add(count, std::memory_order_relaxed);
+        }
+
+        bool waitPop(T& item, Time timeout)
+        {
+            if (pop(item))
+                return true;
+
+            auto deadline = deadlineAfter(timeout);
+
+            if (auto policy = receiveSpin(); policy.enabled())
+            {
+                if (policy.spinUntil(timeout, [&]() { return _size_impl() != 0 || !_shouldReceive || _interrupted; }) && pop(item))
+                    return true;
+            }
+
+            std::unique_lock lock{ _mutex };
+
+            _waitingConsumers.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            bool popped = false;
+
+            _notEmpty.wait_until(lock, deadline, [&]() {
+                popped = pop(item);
+                return popped || !_shouldReceive || _interrupted;
+            });
+
+            _waitingConsumers.fetch_sub(1);
+            _interrupted = false;
+
+            return popped;
+        }
+
+    public:
+        LockFreeQueue(size_t capacity = 10)
+            : _capacity(capacity)
+            , _shouldReceive(true)
+            , _q(capacity)
+        {
+        }
+
+        size_t size()
+        {
+            return _size_impl();
+        }
+
+        size_t capacity()
+        {
+            return _capacity;
+        }
+
+        void capacity(size_t newCapacity)
+        {
+            _capacity = newCapacity;
+
+            notifyProducers();
+        }
+
+        bool isEmpty()
+        {
+            return _size_impl() == 0;
+        }
+
+        bool isFull()
+        {
+            return _isFull_impl();
+        }
+
+        Time producerTimeout()
+        {
+            return _producerTimeout;
+        }
+
+        void producerTimeout(Time timeout)
+        {
+            _producerTimeout = timeout;
+        }
+
+        Time consumerTimeout()
+        {
+            return _consumerTimeout;
+        }
+
+        void consumerTimeout(Time timeout)
+        {
+            _consumerTimeout = timeout;
+        }
+
+        SpinPolicy receiveSpin()
+        {
+            return { _spins, _spinBudget, _yields };
+        }
+
+        void receiveSpin(SpinPolicy policy)
+        {
+            _spins = policy.spins;
+            _spinBudget = policy.budget;
+            _yields = policy.yields;
+        }
+
+        Overflow overflow()
+        {
+            return _overflow;
+        }
+
+        void overflow(Overflow policy)
+        {
+            _overflow = policy;
+        }
+
+        OverflowCounters overflowCounters()
+        {
+            return { _rejected.load(std::memory_order_relaxed), _droppedOldest.load(std::memory_order_relaxed), _droppedNewest.load(std::memory_order_relaxed) };
+        }
+
+        // Locking the mutex before notifying guarantees that a waiter that has registered itself
+        // is already parked on the condition variable and won't miss the notification
+        void notifyProducer()
+        {
+            { std::lock_guard lock{ _mutex }; }
+            _notFull.notify_one();
+        }
+
+        void notifyProducers()
+        {
+            { std::lock_guard lock{ _mutex }; }
+            _notFull.notify_all();
+        }
+
+        void notifyConsumer()
+        {
+            { std::lock_guard lock{ _mutex }; }
+            _notEmpty.notify_one();
+        }
+
+        void notifyConsumers()
+        {
+            { std::lock_guard lock{ _mutex }; }
+            _notEmpty.notify_all();
+        }
+
+        void notifyAll()
+        {
+            { std::lock_guard lock{ _mutex }; }
+            _notEmpty.notify_all();
+            _notFull.notify_all();
+        }
+
+        // Wakes up the consumer waiting in get/getWithStatus/getBulk, it returns Timeout unless an item arrived meanwhile
+        // If no consumer is waiting, the next wait returns right away
+        void interrupt()
+        {
+            _interrupted = true;
+
+            notifyConsumers();
+        }
+
+        void clear()
+        {
+            discardQueued();
+        }
+
+        bool shouldReceive()
+        {
+            return _shouldReceive;
+        }
+
+        void shouldReceive(bool value, ClearCache shouldClear = ClearCache(true))
+        {
+            _shouldReceive = value;
+
+            if (shouldClear)
+                discardQueued();
+
+            notifyListeners();
+            notifyAll();
+        }
+
+        // Makes the queue notify listener whenever items are added or the queue is closed
+        void attach(WakeSignal& listener)
+        {
+            std::lock_guard lock{ _mutex };
+
+            _listeners.push_back(&listener);
+            _listenerCount = _listeners.size();
+        }
+
+        void detach(WakeSignal& listener)
+        {
+            std::lock_guard lock{ _mutex };
+
+            std::erase(_listeners, &listener);
+            _listenerCount = _listeners.size();
+        }
+
+        bool add(T item)
+        {
+            if (!_shouldReceive)
+                return false;
+
+            if (!makeRoom())
+                return dropsNewest();
+
+            push(std::move(item));
+
+            return true;
+        }
+
+        // Enqueues as many items as capacity allows, with Overflow::Block waiting up to producerTimeout in total for the rest
+        // Consumers are woken up once per chunk, returns the number of enqueued items
+        template<typename It>
+        size_t addBulk(It first, It last)
+        {
+            auto deadline = deadlineAfter(_producerTimeout);
+            size_t added = 0;
+
+            while (first != last && _shouldReceive)
+            {
+                auto count = reserve(size_t(std::distance(first, last)));
+
+                if (count == 0)
+                {
+                    auto overflow = _overflow.load();
+
+                    if (overflow == Overflow::DropOldest && dropOldest())
+                        count = 1;
+                    else if (overflow != Overflow::Block || !waitReserve(deadline))
+                        break;
+                    else
+                        count = 1;
+                }
+
+                for (size_t n = 0; n < count; ++n, ++first)
+                    _q.enqueue(T(*first));
+
+                added += count;
+                pushed(count);
+            }
+
+            if (auto rest = size_t(std::distance(first, last)); rest > 0 && _shouldReceive)
+                refuse(rest);
+
+            return added;
+        }
+
+        bool tryAdd(T& item)
+        {
+            if (!_shouldReceive)
+                return false;
+
+            if (!makeRoom(false))
+                return dropsNewest();
+
+            push(std::move(item));
+
+            return true;
+        }
+
+        T get()
+        {
+            T item;
+
+            if (!waitPop(item, _consumerTimeout))
+                return {};
+
+            popped();
+
+            return item;
+        }
+
+        std::pair<SyncQStatus, T> getWithStatus(Time timeout)
+        {
+            T item;
+
+            if (!waitPop(item, timeout))
+                return { !_shouldReceive ? SyncQStatus::Shutdown : SyncQStatus::Timeout, T{} };
+
+            popped();
+
+            return { SyncQStatus::OK, std::move(item) };
+        }
+
+        std::pair<SyncQStatus, T> getWithStatus()
+        {
+            return getWithStatus(_consumerTimeout);
+        }
+
+        // Waits only for the first item, the rest of the batch is whatever is already enqueued
+        template<typename OutputIt>
+        std::pair<SyncQStatus, size_t> getBulk(OutputIt out, size_t maxN, Time timeout)
+        {
+            if (maxN == 0)
+                return { SyncQStatus::OK, 0 };
+
+            T item;
+
+            if (!waitPop(item, timeout))
+                return { !_shouldReceive ? SyncQStatus::Shutdown : SyncQStatus::Timeout, 0 };
+
+            size_t count = 0;
+
+            do
+            {
+                *out = std::move(item);
+                ++out;
+                ++count;
+            } while (count < maxN && pop(item));
+
+            popped(count);
+
+            return { SyncQStatus::OK, count };
+        }
+
+        template<typename OutputIt>
+        std::pair<SyncQStatus, size_t> getBulk(OutputIt out, size_t maxN)
+        {
+            return getBulk(out, maxN, _consumerTimeout);
+        }
+
+        // Same as tryGet, pop never fails because of contention
+        bool poll(T& item)
+        {
+            return tryGet(item);
+        }
+
+        bool tryGet(T& item)
+        {
+            if (!pop(item))
+                return false;
+
+            popped();
+
+            return true;
+        }
+    };
+
+    template<typename T>
+    using SPSCQueue = LockFreeQueue<T, moodycamel::ReaderWriterQueue<T>>;
+
+    template<typename T>
+    using MPMCQueue = LockFreeQueue<T, moodycamel::ConcurrentQueue<T>>;
+}
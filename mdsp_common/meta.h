@@ -2,6 +2,7 @@
 #include <chrono>
 #include <tuple>
 #include <utility>
+#include <string_view>
 #include <type_traits>
 
 namespace mdsp::meta
@@ -150,6 +151,22 @@ namespace mdsp::meta
     template<typename L, typename T>
     using Contains = detail::contains<L, T>;
 
+    namespace detail
+    {
+        template<typename L, typename T>
+        struct index_of;
+
+        template<template<typename...> typename L, typename T, typename... Ts>
+        struct index_of<L<T, Ts...>, T> : std::integral_constant<size_t, 0> {};
+
+        template<template<typename...> typename L, typename T, typename V, typename... Ts>
+        struct index_of<L<V, Ts...>, T> : std::integral_constant<size_t, 1 + index_of<L<Ts...>, T>::value> {};
+    }
+
+    // Position of the first occurrence of T in the type list L (e.g. alternative index in std::variant)
+    template<typename L, typename T>
+    using IndexOf = detail::index_of<L, T>;
+
     namespace detail
     {
         template<typename F>
@@ -271,4 +288,34 @@ namespace mdsp::meta
 
     template<typename T, template<typename...> typename F>
     using Transform = eval_t<detail::transform_impl<T, F>>;
+
+    // Name of T taken from the compiler generated function signature, e.g. "ns::Render"
+    // The exact spelling is compiler specific, it's meant for diagnostics and reports
+    template<typename T>
+    constexpr std::string_view TypeName()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        std::string_view name = __FUNCSIG__;
+
+        // "class std::basic_string_view<...> __cdecl mdsp::meta::TypeName<struct ns::Render>(void)"
+        name = name.substr(name.find("TypeName<") + 9);
+        name = name.substr(0, name.rfind(">(void)"));
+
+        for (std::string_view prefix : { "struct ", "class ", "enum ", "union " })
+        {
+            if (name.substr(0, prefix.size()) == prefix)
+                name.remove_prefix(prefix.size());
+        }
+
+        return name;
+#else
+        std::string_view name = __PRETTY_FUNCTION__;
+
+        // "... mdsp::meta::TypeName() [with T = ns::Render; ...]" (GCC) or "... [T = ns::Render]" (Clang)
+        auto begin = name.find("T = ") + 4;
+        auto end = name.find_first_of(";]", begin);
+
+        return name.substr(begin, end - begin);
+#endif
+    }
 }
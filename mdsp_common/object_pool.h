@@ -0,0 +1,167 @@
+#pragma once
+#include <memory>
+#include <cstddef>
+#include <utility>
+#include <mutex>
+#include <vector>
+
+namespace mdsp
+{
+    // Recycles memory of T objects through a per-thread free list, so that steady create/destroy traffic doesn't allocate.
+    // Objects can be destroyed on a different thread than they were created on, memory goes to the destroying thread's list.
+    // Each thread keeps at most CacheSize free blocks, the rest is returned to the heap.
+    //
+    // Example:
+    //      auto* item = ObjectPool<Item>::create(1, 2);
+    //      ObjectPool<Item>::destroy(item);
+    //
+    template<typename T, size_t CacheSize = 64>
+    class ObjectPool
+    {
+    protected:
+        union Block
+        {
+            Block* next;
+            alignas(T) std::byte storage[sizeof(T)];
+        };
+
+        struct Cache
+        {
+            Block* head = nullptr;
+            size_t size = 0;
+
+            ~Cache()
+            {
+                while (head)
+                    delete std::exchange(head, head->next);
+            }
+        };
+
+        static Cache& cache()
+        {
+            static thread_local Cache cache;
+            return cache;
+        }
+
+    public:
+        template<typename... Args>
+        static T* create(Args&&... args)
+        {
+            auto& free = cache();
+            Block* block = free.head;
+
+            if (block)
+            {
+                free.head = block->next;
+                --free.size;
+            }
+            else
+            {
+                block = new Block;
+            }
+
+            return std::construct_at(reinterpret_cast<T*>(block->storage), std::forward<Args>(args)...);
+        }
+
+        static void destroy(T* item)
+        {
+            std::destroy_at(item);
+
+            auto* block = reinterpret_cast<Block*>(item);
+            auto& free = cache();
+
+            if (free.size >= CacheSize)
+            {
+                delete block;
+                return;
+            }
+
+            block->next = free.head;
+            free.head = block;
+            ++free.size;
+        }
+    };
+
+    // Pool of T objects shared by all threads, for objects created on one thread and destroyed on another
+    // (ObjectPool would keep moving the memory to the destroying thread's list and allocate again on the creating one).
+    // Memory is carved from slabs of SlabSize objects and recycled through a single mutex guarded free list.
+    // Slabs are only released at exit, so the pool keeps the peak number of live objects allocated.
+    //
+    // Example:
+    //      auto* item = SlabPool<Item>::create(1, 2);      // producer thread
+    //      SlabPool<Item>::destroy(item);                  // consumer thread
+    //
+    template<typename T, size_t SlabSize = 64>
+    class SlabPool
+    {
+    protected:
+        union Block
+        {
+            Block* next;
+            alignas(T) std::byte storage[sizeof(T)];
+        };
+
+        struct Shared
+        {
+            std::mutex mutex;
+            Block* head = nullptr;
+            std::vector<std::unique_ptr<Block[]>> slabs;
+        };
+
+        static Shared& shared()
+        {
+            static Shared shared;
+            return shared;
+        }
+
+        static Block* allocate()
+        {
+            auto& pool = shared();
+            std::lock_guard lock{ pool.mutex };
+
+            if (!pool.head)
+            {
+                auto& slab = pool.slabs.emplace_back(std::make_unique<Block[]>(SlabSize));
+
+                for (size_t i = 0; i < SlabSize; ++i)
+                    slab[i].next = i + 1 < SlabSize ? &slab[i + 1] : nullptr;
+
+                pool.head = &slab[0];
+            }
+
+            return std::exchange(pool.head, pool.head->next);
+        }
+
+        static void release(Block* block)
+        {
+            auto& pool = shared();
+            std::lock_guard lock{ pool.mutex };
+
+            block->next = pool.head;
+            pool.head = block;
+        }
+
+    public:
+        template<typename... Args>
+        static T* create(Args&&... args)
+        {
+            auto* block = allocate();
+
+            try
+            {
+                return std::construct_at(reinterpret_cast<T*>(block->storage), std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                release(block);
+                throw;
+            }
+        }
+
+        static void destroy(T* item)
+        {
+            std::destroy_at(item);
+            release(reinterpret_cast<Block*>(item));
+        }
+    };
+}
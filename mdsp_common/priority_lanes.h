@@ -0,0 +1,311 @@
+#pragma once
+#include <array>
+#include <deque>
+#include <bit>
+#include <cstdint>
+#include <cassert>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+#include <functional>
+
+namespace mdsp
+{
+    // SyncQueue storage with N FIFO lanes, lane 0 has the highest priority.
+    // The highest non-empty lane is found in O(1) from a bitmask of non-empty lanes.
+    //
+    // Queue operations map to lanes as follows:
+    // - push_back goes to the back of the last (lowest priority) lane
+    // - push_front goes to the back of lane 0, so urgent items keep their FIFO order among themselves
+    // - push(lane, item) goes to the back of the given lane
+    // - front/pop_front take the item from the highest non-empty lane
+    //
+    // With Aging != 0, after Aging consecutive items taken from the highest lane while lower lanes were waiting,
+    // one item is taken from a lower lane (round-robin over the lower lanes), so they can't be starved.
+    //
+    // Iteration goes lane by lane, from the highest to the lowest priority.
+    // Overflow::DropOldest evicts lowest_front(), the oldest item of the lowest priority lane.
+    template<typename T, size_t Lanes, size_t Aging = 0, typename Lane = std::deque<T>>
+    class PriorityLanes
+    {
+        static_assert(Lanes > 0 && Lanes <= 64, "Number of lanes has to be in [1, 64] range");
+
+    public:
+        using value_type = T;
+        using size_type = size_t;
+
+        static constexpr size_t count = Lanes;
+
+        template<bool Const>
+        class Iterator
+        {
+        protected:
+            friend class Iterator<!Const>;
+
+            using Storage = std::conditional_t<Const, const PriorityLanes, PriorityLanes>;
+            using Inner = std::conditional_t<Const, typename Lane::const_iterator, typename Lane::iterator>;
+
+            Storage* _storage = nullptr;
+            size_t _lane = Lanes;
+            Inner _it{};
+
+            void skipEmpty()
+            {
+                while (_lane < Lanes && _it == _storage->_lanes[_lane].end())
+                {
+                    if (++_lane < Lanes)
+                        _it = _storage->_lanes[_lane].begin();
+                }
+            }
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = std::conditional_t<Const, const T*, T*>;
+            using reference = std::conditional_t<Const, const T&, T&>;
+
+            Iterator() = default;
+
+            Iterator(Storage* storage, size_t lane)
+                : _storage(storage)
+                , _lane(lane)
+            {
+                if (_lane < Lanes)
+                {
+                    _it = _storage->_lanes[_lane].begin();
+                    skipEmpty();
+                }
+            }
+
+            Iterator(Storage* storage, size_t lane, Inner it)
+                : _storage(storage)
+                , _lane(lane)
+                , _it(it)
+            {
+                skipEmpty();
+            }
+
+            operator Iterator<true>() const
+                requires (!Const)
+            {
+                Iterator<true> it;
+
+                it._storage = _storage;
+                it._lane = _lane;
+                it._it = _it;
+
+                return it;
+            }
+
+            reference operator*() const { return *_it; }
+            pointer operator->() const { return &*_it; }
+
+            Iterator& operator++()
+            {
+                ++_it;
+                skipEmpty();
+
+                return *this;
+            }
+
+            Iterator operator++(int)
+            {
+                auto it = *this;
+                ++*this;
+
+                return it;
+            }
+
+            friend bool operator==(const Iterator& lhs, const Iterator& rhs)
+            {
+                if (lhs._lane != rhs._lane)
+                    return false;
+
+                return lhs._lane == Lanes || lhs._it == rhs._it;
+            }
+        };
+
+        using iterator = Iterator<false>;
+        using const_iterator = Iterator<true>;
+
+    protected:
+        std::array<Lane, Lanes> _lanes;
+        uint64_t _nonEmpty = 0;
+        size_t _size = 0;
+
+        // Consecutive items taken from the highest lane while lower lanes were waiting
+        size_t _served = 0;
+
+        // Last lower lane that was served because of aging
+        size_t _aged = 0;
+
+        static constexpr uint64_t below(size_t lane)
+        {
+            return lane + 1 >= 64 ? 0 : ~((uint64_t(2) << lane) - 1);
+        }
+
+        size_t nextLane() const
+        {
+            size_t top = std::countr_zero(_nonEmpty);
+
+            if constexpr (Aging != 0)
+            {
+                if (_served >= Aging)
+                {
+                    auto lower = _nonEmpty & below(top);
+                    auto next = lower & below(_aged);
+
+                    if (lower)
+                        return std::countr_zero(next ? next : lower);
+                }
+            }
+
+            return top;
+        }
+
+        void pushed(size_t lane)
+        {
+            _nonEmpty |= uint64_t(1) << lane;
+            ++_size;
+        }
+
+        void popped(size_t lane)
+        {
+            if (_lanes[lane].empty())
+                _nonEmpty &= ~(uint64_t(1) << lane);
+
+            --_size;
+        }
+
+    public:
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+
+        size_t size(size_t lane) const { return _lanes[lane].size(); }
+
+        void reserve(size_t capacity)
+        {
+            if constexpr (requires (Lane lane) { lane.reserve(capacity); })
+            {
+                for (auto& lane : _lanes)
+                    lane.reserve(capacity);
+            }
+        }
+
+        iterator begin() { return { this, 0 }; }
+        iterator end() { return { this, Lanes }; }
+        const_iterator begin() const { return { this, 0 }; }
+        const_iterator end() const { return { this, Lanes }; }
+
+        T& front() { return _lanes[nextLane()].front(); }
+        const T& front() const { return _lanes[nextLane()].front(); }
+
+        // Item that would be taken last, the back of the lowest non-empty lane
+        T& back() { return _lanes[std::bit_width(_nonEmpty) - 1].back(); }
+        const T& back() const { return _lanes[std::bit_width(_nonEmpty) - 1].back(); }
+
+        // Oldest item of the lowest non-empty lane, the one to evict when the queue is full
+        T& lowest_front() { return _lanes[std::bit_width(_nonEmpty) - 1].front(); }
+        const T& lowest_front() const { return _lanes[std::bit_width(_nonEmpty) - 1].front(); }
+
+        void pop_lowest_front()
+        {
+            size_t lane = std::bit_width(_nonEmpty) - 1;
+
+            _lanes[lane].pop_front();
+            popped(lane);
+        }
+
+        template<typename... Args>
+        T& emplace(size_t lane, Args&&... args)
+        {
+            assert(lane < Lanes);
+
+            auto& item = _lanes[lane].emplace_back(std::forward<Args>(args)...);
+            pushed(lane);
+
+            return item;
+        }
+
+        template<typename... Args>
+        T& emplace_back(Args&&... args)
+        {
+            return emplace(Lanes - 1, std::forward<Args>(args)...);
+        }
+
+        template<typename... Args>
+        T& emplace_front(Args&&... args)
+        {
+            return emplace(0, std::forward<Args>(args)...);
+        }
+
+        void push(size_t lane, T item) { emplace(lane, std::move(item)); }
+        void push_back(T item) { emplace_back(std::move(item)); }
+        void push_front(T item) { emplace_front(std::move(item)); }
+
+        void pop_front()
+        {
+            size_t top = std::countr_zero(_nonEmpty);
+            size_t lane = nextLane();
+
+            _lanes[lane].pop_front();
+            popped(lane);
+
+            if (lane != top)
+            {
+                _served = 0;
+                _aged = lane;
+            }
+            else if (_nonEmpty & below(top))
+            {
+                ++_served;
+            }
+        }
+
+        // Only front insertion is supported (pos is ignored), items are appended to lane 0 in their order
+        template<typename It>
+        iterator insert(const_iterator, It first, It last)
+        {
+            auto index = _lanes[0].size();
+
+            for (; first != last; ++first)
+                emplace(0, *first);
+
+            return { this, 0, std::next(_lanes[0].begin(), index) };
+        }
+
+        template<typename Predicate>
+        size_t erase_if(Predicate&& predicate)
+        {
+            size_t erased = 0;
+
+            for (size_t i = 0; i < Lanes; ++i)
+            {
+                auto& lane = _lanes[i];
+                auto it = std::remove_if(lane.begin(), lane.end(), std::ref(predicate));
+                auto count = size_t(std::distance(it, lane.end()));
+
+                lane.erase(it, lane.end());
+
+                _size -= count;
+                erased += count;
+
+                if (lane.empty())
+                    _nonEmpty &= ~(uint64_t(1) << i);
+            }
+
+            return erased;
+        }
+
+        void clear()
+        {
+            for (auto& lane : _lanes)
+                lane.clear();
+
+            _nonEmpty = 0;
+            _size = 0;
+            _served = 0;
+        }
+    };
+}
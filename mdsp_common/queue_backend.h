@@ -0,0 +1,117 @@
+#pragma once
+#include "sync_queue.h"
+#include "ring_buffer.h"
+#include "priority_lanes.h"
+#include "coalescing_index.h"
+#include "lock_free_queue.h"
+#include "sharded_queue.h"
+#include "boxed.h"
+
+namespace mdsp
+{
+    namespace detail
+    {
+        template<typename Queue>
+        struct Coalesced;
+
+        template<typename T, typename Storage, typename Metrics>
+        struct Coalesced<SyncQueue<T, Storage, Metrics>>
+        {
+            using type = SyncQueue<T, CoalescingIndex<T, Storage>, Metrics>;
+        };
+
+        template<typename Queue>
+        struct Instrumented;
+
+        template<typename T, typename Storage, typename Metrics>
+        struct Instrumented<SyncQueue<T, Storage, Metrics>>
+        {
+            using type = SyncQueue<T, Storage, QueueMetrics>;
+        };
+    }
+
+    // Queue backends select which queue implementation is used by Channel (and cisim::Thread).
+    // Each backend exposes Queue<T> alias, all of them share the SyncQueue add/get interface.
+    //
+    // Example:
+    //      Channel<Commands, backend::SPSC> commands;
+    //
+    namespace backend
+    {
+        // std::mutex + std::condition_variable guarded std::deque, supports every Channel operation
+        struct Mutex
+        {
+            template<typename T>
+            using Queue = SyncQueue<T>;
+        };
+
+        // std::mutex + std::condition_variable guarded RingBuffer, preallocated to the channel capacity
+        // Doesn't allocate on add/get unless the capacity is exceeded (capacity == 0 makes it a growable ring)
+        struct Ring
+        {
+            template<typename T>
+            using Queue = SyncQueue<T, RingBuffer<T>>;
+        };
+
+        // std::mutex + std::condition_variable guarded PriorityLanes with N FIFO lanes (lane 0 is the most urgent)
+        // dispatch::Priority sends to lane 0, dispatch::Serial to the last lane, dispatch::Lane<I> to lane I
+        // Aging != 0 serves a lower lane after Aging consecutive items from the highest one
+        template<size_t N, size_t Aging = 0>
+        struct Lanes
+        {
+            template<typename T>
+            using Queue = SyncQueue<T, PriorityLanes<T, N, Aging>>;
+        };
+
+        // Base backend (Mutex or Ring) with CoalescingIndex storage, Channel::update replaces the newest
+        // queued message of the same type in O(1), keeping its position in the queue
+        template<typename Base = Mutex>
+        struct Coalescing
+        {
+            template<typename T>
+            using Queue = typename detail::Coalesced<typename Base::template Queue<T>>::type;
+        };
+
+        // Base backend (Mutex, Ring, Lanes or Coalescing) recording QueueMetrics, read them with Channel::metrics()
+        // Without it the metrics hooks compile to nothing
+        template<typename Base = Mutex>
+        struct Instrumented
+        {
+            template<typename T>
+            using Queue = typename detail::Instrumented<typename Base::template Queue<T>>::type;
+        };
+
+        // Base backend storing variant alternatives bigger than Threshold bytes as Boxed<T> in a shared SlabPool,
+        // so a queue slot is only as big as the largest small alternative. Boxes are freed by the receiver.
+        // Channel and Thread translate between the alternatives and their boxes, executed commands see the original types.
+        template<typename Base = Mutex, size_t Threshold = 64>
+        struct OutOfLine
+        {
+            template<typename T>
+            using Queue = typename Base::template Queue<typename detail::Compacted<T, Threshold>::type>;
+        };
+
+        // moodycamel::ReaderWriterQueue, only one producer and one consumer thread are allowed
+        struct SPSC
+        {
+            template<typename T>
+            using Queue = SPSCQueue<T>;
+        };
+
+        // moodycamel::ConcurrentQueue, any number of producer and consumer threads
+        struct MPMC
+        {
+            template<typename T>
+            using Queue = MPMCQueue<T>;
+        };
+
+        // ShardedQueue with Shards producer sub-queues, for many producer threads and one consumer
+        // Producers only contend when more than Shards of them are active, messages of one producer stay in order
+        template<size_t Shards = 8>
+        struct Sharded
+        {
+            template<typename T>
+            using Queue = ShardedQueue<T, Shards>;
+        };
+    }
+}
@@ -0,0 +1,255 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <algorithm>
+#include "timestamp.h"
+#include "ring_buffer.h"
+
+namespace mdsp
+{
+    // Copy of QueueMetrics counters, see Channel::metrics()
+    struct QueueMetricsSnapshot
+    {
+        // Bucket i counts values in [2^(i-1), 2^i), bucket 0 counts zeros, the last one everything above
+        static constexpr size_t Buckets = 32;
+
+        using Histogram = std::array<uint64_t, Buckets>;
+
+        uint64_t enqueued = 0;
+        uint64_t dequeued = 0;
+
+        // Queue depth seen by each enqueued item (number of items already queued)
+        Histogram depth{};
+        size_t maxDepth = 0;
+
+        // Enqueue to dequeue time in microseconds
+        Histogram latency{};
+        Time totalLatency = Time::Zero();
+        Time maxLatency = Time::Zero();
+
+        // Producers that had to wait for a free slot and the time they spent waiting
+        uint64_t blocked = 0;
+        Time blockedTime = Time::Zero();
+        Time maxBlockedTime = Time::Zero();
+
+        // Items not accepted because the queue stopped receiving (or didn't fit within producerTimeout in bulk adds)
+        uint64_t rejected = 0;
+
+        // Items dropped by Overflow::DropOldest/DropNewest
+        uint64_t dropped = 0;
+
+        // Producer waits for a free slot that ran out of producerTimeout
+        uint64_t producerTimeouts = 0;
+
+        // Consumer waits for an item that ran out of the timeout
+        uint64_t consumerTimeouts = 0;
+
+        Time meanLatency() const
+        {
+            return dequeued > 0 ? totalLatency / int64_t(dequeued) : Time::Zero();
+        }
+
+        // Upper bound of the histogram bucket the given fraction (e.g. 0.99) of values falls into
+        static uint64_t percentile(const Histogram& histogram, double fraction)
+        {
+            uint64_t total = 0;
+
+            for (auto count : histogram)
+                total += count;
+
+            uint64_t threshold = uint64_t(double(total) * fraction);
+            uint64_t seen = 0;
+
+            for (size_t i = 0; i < Buckets; ++i)
+            {
+                seen += histogram[i];
+
+                if (seen >= threshold && seen > 0)
+                    return i == 0 ? 0 : (uint64_t(1) << i) - 1;
+            }
+
+            return 0;
+        }
+    };
+
+    // Disabled instrumentation, SyncQueue default: every hook is an empty inline function
+    struct NoMetrics
+    {
+        static constexpr bool enabled = false;
+
+        void enqueued(size_t, size_t = 1, bool = false) {}
+        void dequeued() {}
+        void truncated(size_t) {}
+        void blocked(Time) {}
+        void rejected(size_t = 1) {}
+        void dropped(size_t, bool) {}
+        void producerTimeout() {}
+        void consumerTimeout() {}
+    };
+
+    // SyncQueue instrumentation (backend::Instrumented), the hooks are called with the queue mutex held.
+    // Counters are atomics, so that snapshot() can read them without the lock while the queue is in use.
+    // Writers are serialized by the queue mutex, so counters are updated with plain load/store instead of RMW operations.
+    //
+    // Enqueue timestamps are kept in a FIFO next to the queue storage. Latency is exact for FIFO storages,
+    // with PriorityLanes or selective removal (remove<Ts...>) it's approximate.
+    class QueueMetrics
+    {
+    protected:
+        using Counter = std::atomic<uint64_t>;
+        using Histogram = std::array<Counter, QueueMetricsSnapshot::Buckets>;
+
+        Counter _enqueued = 0;
+        Counter _dequeued = 0;
+
+        Histogram _depth{};
+        std::atomic<size_t> _maxDepth = 0;
+
+        Histogram _latency{};
+        std::atomic<Time> _totalLatency = Time::Zero();
+        std::atomic<Time> _maxLatency = Time::Zero();
+
+        Counter _blocked = 0;
+        std::atomic<Time> _blockedTime = Time::Zero();
+        std::atomic<Time> _maxBlockedTime = Time::Zero();
+
+        Counter _rejected = 0;
+        Counter _dropped = 0;
+        Counter _producerTimeouts = 0;
+        Counter _consumerTimeouts = 0;
+
+        RingBuffer<Time> _stamps;
+
+        template<typename T, typename U>
+        static void add(std::atomic<T>& counter, U value)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        template<typename T>
+        static void raise(std::atomic<T>& maximum, T value)
+        {
+            if (value > maximum.load(std::memory_order_relaxed))
+                maximum.store(value, std::memory_order_relaxed);
+        }
+
+        static size_t bucket(uint64_t value)
+        {
+            return (std::min)(size_t(std::bit_width(value)), QueueMetricsSnapshot::Buckets - 1);
+        }
+
+        static void copy(const Histogram& from, QueueMetricsSnapshot::Histogram& to)
+        {
+            for (size_t i = 0; i < from.size(); ++i)
+                to[i] = from[i].load(std::memory_order_relaxed);
+        }
+
+    public:
+        static constexpr bool enabled = true;
+
+        // count items were added to a queue holding depth items, front ones are dequeued first
+        void enqueued(size_t depth, size_t count = 1, bool front = false)
+        {
+            if (count == 0)
+                return;
+
+            auto now = Time::NowSteady();
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (front)
+                    _stamps.emplace_front(now);
+                else
+                    _stamps.emplace_back(now);
+
+                add(_depth[bucket(depth + i)], 1);
+            }
+
+            raise(_maxDepth, depth + count - 1);
+            add(_enqueued, count);
+        }
+
+        void dequeued()
+        {
+            if (_stamps.empty())
+                return;
+
+            auto latency = Time::NowSteady() - _stamps.front();
+            _stamps.pop_front();
+
+            add(_latency[bucket(uint64_t((std::max)(latency.microseconds<int64_t>(), int64_t(0))))], 1);
+            add(_totalLatency, latency);
+            raise(_maxLatency, latency);
+            add(_dequeued, 1);
+        }
+
+        // Items were dropped without being dequeued, size of them remain
+        void truncated(size_t size)
+        {
+            _stamps.truncate(size);
+        }
+
+        void blocked(Time duration)
+        {
+            add(_blocked, 1);
+            add(_blockedTime, duration);
+            raise(_maxBlockedTime, duration);
+        }
+
+        void rejected(size_t count = 1)
+        {
+            add(_rejected, count);
+        }
+
+        // count items were dropped by the overflow policy, queued ones from the front of the queue
+        void dropped(size_t count, bool queued)
+        {
+            if (queued)
+            {
+                for (size_t i = 0; i < count && !_stamps.empty(); ++i)
+                    _stamps.pop_front();
+            }
+
+            add(_dropped, count);
+        }
+
+        void producerTimeout()
+        {
+            add(_producerTimeouts, 1);
+        }
+
+        void consumerTimeout()
+        {
+            add(_consumerTimeouts, 1);
+        }
+
+        // Lock-free, but not an atomic cut: counters updated meanwhile can be off by the in-flight operations
+        QueueMetricsSnapshot snapshot() const
+        {
+            QueueMetricsSnapshot snapshot;
+
+            snapshot.enqueued = _enqueued.load(std::memory_order_relaxed);
+            snapshot.dequeued = _dequeued.load(std::memory_order_relaxed);
+
+            copy(_depth, snapshot.depth);
+            snapshot.maxDepth = _maxDepth.load(std::memory_order_relaxed);
+
+            copy(_latency, snapshot.latency);
+            snapshot.totalLatency = _totalLatency.load(std::memory_order_relaxed);
+            snapshot.maxLatency = _maxLatency.load(std::memory_order_relaxed);
+
+            snapshot.blocked = _blocked.load(std::memory_order_relaxed);
+            snapshot.blockedTime = _blockedTime.load(std::memory_order_relaxed);
+            snapshot.maxBlockedTime = _maxBlockedTime.load(std::memory_order_relaxed);
+
+            snapshot.rejected = _rejected.load(std::memory_order_relaxed);
+            snapshot.dropped = _dropped.load(std::memory_order_relaxed);
+            snapshot.producerTimeouts = _producerTimeouts.load(std::memory_order_relaxed);
+            snapshot.consumerTimeouts = _consumerTimeouts.load(std::memory_order_relaxed);
+
+            return snapshot;
+        }
+    };
+}
@@ -0,0 +1,298 @@
+#pragma once
+#include <memory>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <cstddef>
+
+namespace mdsp
+{
+    // Contiguous circular buffer with a std::deque-like interface, usable as SyncQueue storage.
+    // Capacity is set up front with reserve(), after that push/pop at both ends never allocate.
+    // Pushing into a full buffer grows it (doubling), so it can also be used as an unbounded queue.
+    //
+    // Example:
+    //      RingBuffer<int> ring(4);
+    //      ring.push_back(1);
+    //      ring.push_front(0);
+    //      ring.pop_front(); // ring.front() == 1
+    //
+    template<typename T>
+    class RingBuffer
+    {
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+
+        template<bool Const>
+        class Iterator
+        {
+        protected:
+            friend class RingBuffer;
+
+            using Buffer = std::conditional_t<Const, const RingBuffer, RingBuffer>;
+
+            Buffer* _buffer = nullptr;
+            size_t _index = 0;
+
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = std::conditional_t<Const, const T*, T*>;
+            using reference = std::conditional_t<Const, const T&, T&>;
+
+            Iterator() = default;
+
+            Iterator(Buffer* buffer, size_t index)
+                : _buffer(buffer)
+                , _index(index)
+            {
+            }
+
+            operator Iterator<true>() const
+                requires (!Const)
+            {
+                return { _buffer, _index };
+            }
+
+            reference operator*() const { return (*_buffer)[_index]; }
+            pointer operator->() const { return &(*_buffer)[_index]; }
+            reference operator[](difference_type n) const { return (*_buffer)[_index + n]; }
+
+            Iterator& operator++() { ++_index; return *this; }
+            Iterator& operator--() { --_index; return *this; }
+            Iterator operator++(int) { auto it = *this; ++_index; return it; }
+            Iterator operator--(int) { auto it = *this; --_index; return it; }
+
+            Iterator& operator+=(difference_type n) { _index += n; return *this; }
+            Iterator& operator-=(difference_type n) { _index -= n; return *this; }
+
+            friend Iterator operator+(Iterator it, difference_type n) { return it += n; }
+            friend Iterator operator+(difference_type n, Iterator it) { return it += n; }
+            friend Iterator operator-(Iterator it, difference_type n) { return it -= n; }
+            friend difference_type operator-(const Iterator& lhs, const Iterator& rhs) { return difference_type(lhs._index) - difference_type(rhs._index); }
+
+            friend bool operator==(const Iterator& lhs, const Iterator& rhs) { return lhs._index == rhs._index; }
+            friend auto operator<=>(const Iterator& lhs, const Iterator& rhs) { return lhs._index <=> rhs._index; }
+        };
+
+        using iterator = Iterator<false>;
+        using const_iterator = Iterator<true>;
+
+    protected:
+        std::allocator<T> _allocator;
+        T* _data = nullptr;
+        size_t _capacity = 0;
+        size_t _head = 0;
+        size_t _size = 0;
+
+        size_t wrap(size_t index) const
+        {
+            return index >= _capacity ? index - _capacity : index;
+        }
+
+        T* slot(size_t index) const
+        {
+            return _data + wrap(_head + index);
+        }
+
+        void reallocate(size_t newCapacity)
+        {
+            T* data = _allocator.allocate(newCapacity);
+
+            for (size_t i = 0; i < _size; ++i)
+            {
+                std::construct_at(data + i, std::move(*slot(i)));
+                std::destroy_at(slot(i));
+            }
+
+            if (_data)
+                _allocator.deallocate(_data, _capacity);
+
+            _data = data;
+            _capacity = newCapacity;
+            _head = 0;
+        }
+
+        void grow()
+        {
+            if (_size == _capacity)
+                reallocate(std::max<size_t>(1, _capacity * 2));
+        }
+
+    public:
+        RingBuffer() = default;
+
+        explicit RingBuffer(size_t capacity)
+        {
+            reserve(capacity);
+        }
+
+        RingBuffer(const RingBuffer& other)
+        {
+            reserve(other._capacity);
+
+            for (auto& item : other)
+                push_back(item);
+        }
+
+        RingBuffer(RingBuffer&& other) noexcept
+            : _data(std::exchange(other._data, nullptr))
+            , _capacity(std::exchange(other._capacity, 0))
+            , _head(std::exchange(other._head, 0))
+            , _size(std::exchange(other._size, 0))
+        {
+        }
+
+        RingBuffer& operator=(RingBuffer other) noexcept
+        {
+            std::swap(_data, other._data);
+            std::swap(_capacity, other._capacity);
+            std::swap(_head, other._head);
+            std::swap(_size, other._size);
+
+            return *this;
+        }
+
+        ~RingBuffer()
+        {
+            clear();
+
+            if (_data)
+                _allocator.deallocate(_data, _capacity);
+        }
+
+        size_t size() const { return _size; }
+        size_t capacity() const { return _capacity; }
+        bool empty() const { return _size == 0; }
+        bool full() const { return _size == _capacity; }
+
+        // Changes the allocated capacity, it never drops below the number of stored items
+        void reserve(size_t newCapacity)
+        {
+            newCapacity = std::max(newCapacity, _size);
+
+            if (newCapacity != _capacity && newCapacity != 0)
+                reallocate(newCapacity);
+        }
+
+        T& operator[](size_t index) { return *slot(index); }
+        const T& operator[](size_t index) const { return *slot(index); }
+
+        T& front() { return *slot(0); }
+        const T& front() const { return *slot(0); }
+        T& back() { return *slot(_size - 1); }
+        const T& back() const { return *slot(_size - 1); }
+
+        iterator begin() { return { this, 0 }; }
+        iterator end() { return { this, _size }; }
+        const_iterator begin() const { return { this, 0 }; }
+        const_iterator end() const { return { this, _size }; }
+
+        template<typename... Args>
+        T& emplace_back(Args&&... args)
+        {
+            grow();
+
+            T* item = std::construct_at(slot(_size), std::forward<Args>(args)...);
+            ++_size;
+
+            return *item;
+        }
+
+        template<typename... Args>
+        T& emplace_front(Args&&... args)
+        {
+            grow();
+
+            size_t head = _head == 0 ? _capacity - 1 : _head - 1;
+            T* item = std::construct_at(_data + head, std::forward<Args>(args)...);
+
+            _head = head;
+            ++_size;
+
+            return *item;
+        }
+
+        void push_back(const T& item) { emplace_back(item); }
+        void push_back(T&& item) { emplace_back(std::move(item)); }
+        void push_front(const T& item) { emplace_front(item); }
+        void push_front(T&& item) { emplace_front(std::move(item)); }
+
+        void pop_front()
+        {
+            std::destroy_at(slot(0));
+
+            _head = wrap(_head + 1);
+            --_size;
+        }
+
+        void pop_back()
+        {
+            std::destroy_at(slot(_size - 1));
+
+            --_size;
+        }
+
+        // Inserts [first, last) before pos, front insertion keeps the order of the inserted items
+        template<typename It>
+        iterator insert(const_iterator pos, It first, It last)
+        {
+            size_t index = pos._index;
+            size_t count = size_t(std::distance(first, last));
+
+            if (_size + count > _capacity)
+                reallocate(std::max(_size + count, _capacity * 2));
+
+            if (index == 0)
+            {
+                size_t head = wrap(_head + _capacity - count);
+
+                for (size_t i = 0; i < count; ++i, ++first)
+                    std::construct_at(_data + wrap(head + i), *first);
+
+                _head = head;
+                _size += count;
+
+                return begin();
+            }
+
+            for (; first != last; ++first)
+                emplace_back(*first);
+
+            std::rotate(begin() + index, end() - count, end());
+
+            return begin() + index;
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            size_t index = first._index;
+            size_t count = last._index - first._index;
+
+            std::move(begin() + index + count, end(), begin() + index);
+            truncate(_size - count);
+
+            return begin() + index;
+        }
+
+        // Removes the last items so that only count remain
+        void truncate(size_t count)
+        {
+            while (_size > count)
+                pop_back();
+        }
+
+        void clear()
+        {
+            truncate(0);
+
+            _head = 0;
+        }
+    };
+}
@@ -0,0 +1,776 @@
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <array>
+#include <deque>
+#include <vector>
+#include <utility>
+#include <limits>
+#include <iterator>
+#include <algorithm>
+#include <variant>
+#include "timestamp.h"
+#include "atomic_wait.h"
+#include "sync_queue.h"
+
+#undef min
+#undef max
+
+namespace mdsp
+{
+    // SyncQueue counterpart for many producers feeding one consumer.
+    // Items are kept in Shards sub-queues, each with its own mutex, and every producer thread always adds to
+    // the same shard. The consumer drains the shards round-robin, one item per shard.
+    //
+    // Shards are assigned per thread, not per queue: a thread gets the next shard number (modulo Shards) on its first add
+    // to any ShardedQueue of the same type and keeps it for all of them, for its whole lifetime. With long-lived producer threads
+    // created together that spreads them evenly, but threads that exited still took their number, so two active
+    // producers can share a shard (and contend on it) even when fewer than Shards producers are active.
+    //
+    // Items of one producer are received in the order they were added, there's no ordering between producers.
+    // Capacity, producer/consumer timeouts, shouldReceive, clear and the overflow policy behave the same as in SyncQueue,
+    // Overflow::DropOldest drops the item the consumer would receive next. Front insertion isn't supported.
+    //
+    // Like LockFreeQueue, the queue mutex is only used to park producers/consumers when the queue is full/empty
+    // and the other side only touches it when someone is actually parked.
+    template<typename T, size_t Shards = 8, typename Storage = std::deque<T>>
+    class ShardedQueue
+    {
+    public:
+        using value_type = T;
+
+    protected:
+        static_assert(Shards > 0, "ShardedQueue needs at least one shard");
+
+        // Padded to a cache line, so producers on different shards don't share one
+        struct alignas(64) Shard
+        {
+            std::mutex mutex;
+            Storage q;
+        };
+
+        std::atomic<Time> _producerTimeout = Time::FromSeconds(std::numeric_limits<int>::max());
+        std::atomic<Time> _consumerTimeout = Time::FromSeconds(5);
+        std::atomic<size_t> _capacity;
+        std::atomic<bool> _shouldReceive;
+        std::atomic<Overflow> _overflow = Overflow::Block;
+
+        std::atomic<uint64_t> _rejected = 0;
+        std::atomic<uint64_t> _droppedOldest = 0;
+        std::atomic<uint64_t> _droppedNewest = 0;
+
+        // Receive SpinPolicy fields, kept separately so that they stay lock-free
+        std::atomic<size_t> _spins = 0;
+        std::atomic<Time> _spinBudget = Time::Zero();
+        std::atomic<size_t> _yields = 0;
+
+        // Number of items in all shards, reserved by producers before the item is added so capacity is never exceeded
+        std::atomic<size_t> _size = 0;
+
+        // Shard the consumer looks at first
+        std::atomic<size_t> _next = 0;
+
+        std::array<Shard, Shards> _shards;
+
+        std::mutex _mutex;
+        std::condition_variable _notFull;
+        std::condition_variable _notEmpty;
+        std::atomic<size_t> _waitingProducers = 0;
+        std::atomic<size_t> _waitingConsumers = 0;
+
+        // Signals of WaitSets waiting on this queue (guarded by _mutex), notified whenever items are added or the queue is closed
+        std::vector<WakeSignal*> _listeners;
+        std::atomic<size_t> _listenerCount = 0;
+
+        // Set by interrupt(), makes the current (or next) consumer wait return early
+        std::atomic_bool _interrupted = false;
+
+        // Shared by all ShardedQueues of the same type, see the class comment
+        static size_t producerShard()
+        {
+            static std::atomic<size_t> threads = 0;
+            static thread_local size_t shard = threads.fetch_add(1, std::memory_order_relaxed) % Shards;
+
+            return shard;
+        }
+
+        bool _isFull_impl() const
+        {
+            auto capacity = _capacity.load(std::memory_order_relaxed);
+
+            if (capacity == 0)
+                return false;
+
+            return _size.load() >= capacity;
+        }
+
+        bool producerShouldWait() const
+        {
+            return _shouldReceive && _isFull_impl();
+        }
+
+        // Claims up to count free slots, returns the number of claimed ones
+        size_t reserve(size_t count)
+        {
+            auto capacity = _capacity.load(std::memory_order_relaxed);
+
+            if (capacity == 0)
+            {
+                _size.fetch_add(count);
+                return count;
+            }
+
+            auto size = _size.load();
+
+            while (size < capacity)
+            {
+                auto claimed = std::min(count, capacity - size);
+
+                if (_size.compare_exchange_weak(size, size + claimed))
+                    return claimed;
+            }
+
+            return 0;
+        }
+
+        // Calls handler(q) on the shards starting from the next one for the consumer, until it returns true
+        // handler is called with the shard locked, returns false if no shard accepted
+        template<typename F>
+        bool scan(F&& handler)
+        {
+            auto first = _next.load(std::memory_order_relaxed);
+
+            for (size_t i = 0; i < Shards; ++i)
+            {
+                auto index = (first + i) % Shards;
+                auto& shard = _shards[index];
+
+                std::lock_guard lock{ shard.mutex };
+
+                if (shard.q.empty() || !handler(shard.q))
+                    continue;
+
+                _next.store((index + 1) % Shards, std::memory_order_relaxed);
+
+                return true;
+            }
+
+            return false;
+        }
+
+        bool pop(T& item)
+        {
+            if (_size.load() == 0)
+                return false;
+
+            return scan([&](Storage& q) {
+                item = std::move(q.front());
+                q.pop_front();
+                _size.fetch_sub(1);
+
+                return true;
+            });
+        }
+
+        // Moves up to maxN items to out, taking one item per shard in turn, under a single lock per shard
+        // The shards are counted and drained under separate locks, Overflow::DropOldest can remove items in between
+        // (the plan is only an upper bound), a second consumer isn't supported
+        template<typename OutputIt>
+        size_t popBulk(OutputIt& out, size_t maxN)
+        {
+            std::array<size_t, Shards> counts{};
+            size_t total = 0;
+
+            auto first = _next.load(std::memory_order_relaxed);
+
+            for (size_t i = 0; i < Shards; ++i)
+            {
+                auto& shard = _shards[(first + i) % Shards];
+
+                std::lock_guard lock{ shard.mutex };
+                counts[i] = shard.q.size();
+                total += counts[i];
+            }
+
+            // Shares of the batch are taken round-robin, so that one busy shard doesn't starve the others
+            std::array<size_t, Shards> take{};
+            size_t planned = 0;
+
+            while (planned < maxN && planned < total)
+            {
+                for (size_t i = 0; i < Shards && planned < maxN; ++i)
+                {
+                    if (take[i] < counts[i])
+                    {
+                        ++take[i];
+                        ++planned;
+                    }
+                }
+            }
+
+            size_t count = 0;
+            size_t last = Shards;
+
+            for (size_t i = 0; i < Shards; ++i)
+            {
+                if (take[i] == 0)
+                    continue;
+
+                auto& shard = _shards[(first + i) % Shards];
+
+                std::lock_guard lock{ shard.mutex };
+
+                // A producer dropping the oldest item may have taken some of them meanwhile
+                for (size_t n = 0; n < take[i] && !shard.q.empty(); ++n, ++count)
+                {
+                    *out = std::move(shard.q.front());
+                    ++out;
+                    shard.q.pop_front();
+                    last = i;
+                }
+            }
+
+            _size.fetch_sub(count);
+
+            // The next receive starts after the last shard that gave an item
+            if (last != Shards)
+                _next.store((first + last + 1) % Shards, std::memory_order_relaxed);
+
+            return count;
+        }
+
+        void notifyListeners()
+        {
+            std::lock_guard lock{ _mutex };
+
+            for (auto* listener : _listeners)
+                listener->notify();
+        }
+
+        void pushed(size_t count = 1)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (count == 0)
+                return;
+
+            if (_listenerCount.load() != 0)
+                notifyListeners();
+
+            if (_waitingConsumers.load() == 0)
+                return;
+
+            if (count > 1)
+                notifyConsumers();
+            else
+                notifyConsumer();
+        }
+
+        void popped(size_t count = 1)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (_waitingProducers.load() == 0)
+                return;
+
+            if (count > 1)
+                notifyProducers();
+            else
+                notifyProducer();
+        }
+
+        // Waits until a slot is claimed, the deadline passes or the queue stops receiving
+        bool waitReserve(std::chrono::steady_clock::time_point deadline)
+        {
+            std::unique_lock lock{ _mutex };
+
+            _waitingProducers.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // A claimed slot belongs to the caller even if the queue stops receiving meanwhile,
+            // returning false would leak it
+            bool claimed = false;
+
+            _notFull.wait_until(lock, deadline, [&]() { return !_shouldReceive || (claimed = reserve(1) == 1); });
+
+            _waitingProducers.fetch_sub(1);
+
+            return claimed;
+        }
+
+        // Applies the overflow policy until a slot is claimed, returns false if the new item mustn't be added
+        // Overflow::Block only waits if mayBlock is set
+        bool makeRoom(bool mayBlock = true)
+        {
+            if (reserve(1) == 1)
+                return true;
+
+            auto overflow = _overflow.load();
+
+            // The dropped item's slot is handed over to the new one
+            if (overflow == Overflow::DropOldest && (dropOldest() || reserve(1) == 1))
+                return true;
+
+            if (overflow == Overflow::Block && mayBlock && waitReserve(deadlineAfter(_producerTimeout)))
+                return true;
+
+            refuse(1);
+
+            return false;
+        }
+
+        // Removes the item the consumer would receive next, its slot stays claimed
+        bool dropOldest()
+        {
+            bool dropped = scan([&](Storage& q) {
+                q.pop_front();
+
+                return true;
+            });
+
+            if (dropped)
+                _droppedOldest.fetch_add(1, std::memory_order_relaxed);
+
+            return dropped;
+        }
+
+        void refuse(size_t count)
+        {
+            if (_overflow == Overflow::DropNewest)
+                _droppedNewest.fetch_add(count, std::memory_order_relaxed);
+            else
+                _rejected.fetch_add(count, std::memory_order_relaxed);
+        }
+
+        // Adds an item to a slot claimed with reserve/makeRoom
+        void push(T&& item)
+        {
+            auto& shard = _shards[producerShard()];
+
+            {
+                std::lock_guard lock{ shard.mutex };
+                shard.q.push_back(std::move(item));
+            }
+
+            pushed();
+        }
+
+        bool waitPop(T& item, Time timeout)
+        {
+            if (pop(item))
+                return true;
+
+            auto deadline = deadlineAfter(timeout);
+
+            if (auto policy = receiveSpin(); policy.enabled())
+            {
+                if (policy.spinUntil(timeout, [&]() { return _size.load() != 0 || !_shouldReceive || _interrupted; }) && pop(item))
+                    return true;
+            }
+
+            std::unique_lock lock{ _mutex };
+
+            _waitingConsumers.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            bool popped = false;
+
+            _notEmpty.wait_until(lock, deadline, [&]() {
+                popped = pop(item);
+                return popped || !_shouldReceive || _interrupted;
+            });
+
+            _waitingConsumers.fetch_sub(1);
+            _interrupted = false;
+
+            return popped;
+        }
+
+        size_t clearShards()
+        {
+            size_t cleared = 0;
+
+            for (auto& shard : _shards)
+            {
+                std::lock_guard lock{ shard.mutex };
+
+                cleared += shard.q.size();
+                shard.q.clear();
+            }
+
+            _size.fetch_sub(cleared);
+
+            return cleared;
+        }
+
+    public:
+        ShardedQueue(size_t capacity = 10)
+            : _capacity(capacity)
+            , _shouldReceive(true)
+        {
+        }
+
+        size_t size()
+        {
+            return _size;
+        }
+
+        size_t capacity()
+        {
+            return _capacity;
+        }
+
+        void capacity(size_t newCapacity)
+        {
+            _capacity = newCapacity;
+
+            notifyProducers();
+        }
+
+        bool isEmpty()
+        {
+            return _size == 0;
+        }
+
+        bool isFull()
+        {
+            return _isFull_impl();
+        }
+
+        Time producerTimeout()
+        {
+            return _producerTimeout;
+        }
+
+        void producerTimeout(Time timeout)
+        {
+            _producerTimeout = timeout;
+        }
+
+        Time consumerTimeout()
+        {
+            return _consumerTimeout;
+        }
+
+        void consumerTimeout(Time timeout)
+        {
+            _consumerTimeout = timeout;
+        }
+
+        SpinPolicy receiveSpin()
+        {
+            return { _spins, _spinBudget, _yields };
+        }
+
+        void receiveSpin(SpinPolicy policy)
+        {
+            _spins = policy.spins;
+            _spinBudget = policy.budget;
+            _yields = policy.yields;
+        }
+
+        Overflow overflow()
+        {
+            return _overflow;
+        }
+
+        void overflow(Overflow policy)
+        {
+            _overflow = policy;
+        }
+
+        OverflowCounters overflowCounters()
+        {
+            return { _rejected.load(std::memory_order_relaxed), _droppedOldest.load(std::memory_order_relaxed), _droppedNewest.load(std::memory_order_relaxed) };
+        }
+
+        // Locking the mutex before notifying guarantees that a waiter that has registered itself
+        // is already parked on the condition variable and won't miss the notification
+        void notifyProducer()
+        {
+            { std::lock_guard lock{ _mutex }; }
+            _notFull.notify_one();
+        }
+
+        void notifyProducers()
+        {
+            { std::lock_guard lock{ _mutex }; }
+            _notFull.notify_all();
+        }
+
+        void notifyConsumer()
+        {
+            { std::lock_guard lock{ _mutex }; }
+            _notEmpty.notify_one();
+        }
+
+        void notifyConsumers()
+        {
+            { std::lock_guard lock{ _mutex }; }
+            _notEmpty.notify_all();
+        }
+
+        void notifyAll()
+        {
+            { std::lock_guard lock{ _mutex }; }
+            _notEmpty.notify_all();
+            _notFull.notify_all();
+        }
+
+        // Wakes up the consumer waiting in get/getWithStatus/getBulk, it returns Timeout unless an item arrived meanwhile
+        // If no consumer is waiting, the next wait returns right away
+        void interrupt()
+        {
+            _interrupted = true;
+
+            notifyConsumers();
+        }
+
+        void clear()
+        {
+            if (auto cleared = clearShards(); cleared > 0)
+                popped(cleared);
+        }
+
+        bool shouldReceive()
+        {
+            return _shouldReceive;
+        }
+
+        void shouldReceive(bool value, ClearCache shouldClear = ClearCache(true))
+        {
+            _shouldReceive = value;
+
+            if (shouldClear)
+                clearShards();
+
+            notifyListeners();
+            notifyAll();
+        }
+
+        // Makes the queue notify listener whenever items are added or the queue is closed
+        void attach(WakeSignal& listener)
+        {
+            std::lock_guard lock{ _mutex };
+
+            _listeners.push_back(&listener);
+            _listenerCount = _listeners.size();
+        }
+
+        void detach(WakeSignal& listener)
+        {
+            std::lock_guard lock{ _mutex };
+
+            std::erase(_listeners, &listener);
+            _listenerCount = _listeners.size();
+        }
+
+        bool add(T item)
+        {
+            if (!_shouldReceive)
+                return false;
+
+            if (!makeRoom())
+                return _overflow == Overflow::DropNewest;
+
+            push(std::move(item));
+
+            return true;
+        }
+
+        // Adds as many items as capacity allows to the producer's shard under one lock per chunk,
+        // with Overflow::Block waiting up to producerTimeout in total for the rest
+        // Consumers are woken up once per chunk, returns the number of added items
+        template<typename It>
+        size_t addBulk(It first, It last)
+        {
+            auto deadline = deadlineAfter(_producerTimeout);
+            auto& shard = _shards[producerShard()];
+            size_t added = 0;
+
+            while (first != last && _shouldReceive)
+            {
+                auto count = reserve(size_t(std::distance(first, last)));
+
+                if (count == 0)
+                {
+                    auto overflow = _overflow.load();
+
+                    if (overflow == Overflow::DropOldest && dropOldest())
+                        count = 1;
+                    else if (overflow != Overflow::Block || !waitReserve(deadline))
+                        break;
+                    else
+                        count = 1;
+                }
+
+                {
+                    std::lock_guard lock{ shard.mutex };
+
+                    for (size_t n = 0; n < count; ++n, ++first)
+                        shard.q.push_back(T(*first));
+                }
+
+                added += count;
+                pushed(count);
+            }
+
+            if (auto rest = size_t(std::distance(first, last)); rest > 0 && _shouldReceive)
+                refuse(rest);
+
+            return added;
+        }
+
+        bool tryAdd(T& item)
+        {
+            if (!_shouldReceive)
+                return false;
+
+            if (!makeRoom(false))
+                return _overflow == Overflow::DropNewest;
+
+            push(std::move(item));
+
+            return true;
+        }
+
+        T get()
+        {
+            T item;
+
+            if (!waitPop(item, _consumerTimeout))
+                return {};
+
+            popped();
+
+            return item;
+        }
+
+        std::pair<SyncQStatus, T> getWithStatus(Time timeout)
+        {
+            T item;
+
+            if (!waitPop(item, timeout))
+                return { !_shouldReceive ? SyncQStatus::Shutdown : SyncQStatus::Timeout, T{} };
+
+            popped();
+
+            return { SyncQStatus::OK, std::move(item) };
+        }
+
+        std::pair<SyncQStatus, T> getWithStatus()
+        {
+            return getWithStatus(_consumerTimeout);
+        }
+
+        // Waits only for the first item, the rest of the batch is taken from all shards in turn
+        // Receiving (get*, poll, tryGet) is single consumer: only one thread may receive at a time
+        template<typename OutputIt>
+        std::pair<SyncQStatus, size_t> getBulk(OutputIt out, size_t maxN, Time timeout)
+        {
+            if (maxN == 0)
+                return { SyncQStatus::OK, 0 };
+
+            T item;
+
+            if (!waitPop(item, timeout))
+                return { !_shouldReceive ? SyncQStatus::Shutdown : SyncQStatus::Timeout, 0 };
+
+            *out = std::move(item);
+            ++out;
+
+            size_t count = 1 + popBulk(out, maxN - 1);
+
+            popped(count);
+
+            return { SyncQStatus::OK, count };
+        }
+
+        template<typename OutputIt>
+        std::pair<SyncQStatus, size_t> getBulk(OutputIt out, size_t maxN)
+        {
+            return getBulk(out, maxN, _consumerTimeout);
+        }
+
+        // Single consumer, see getBulk
+        bool poll(T& item)
+        {
+            if (!pop(item))
+                return false;
+
+            popped();
+
+            return true;
+        }
+
+        // Same as poll, shards are only locked for a single push/pop so waiting for them is short
+        bool tryGet(T& item)
+        {
+            return poll(item);
+        }
+
+        // Visits the items shard by shard, each shard is locked while it's visited
+        template<typename F>
+        void forEach(F&& handler)
+        {
+            for (auto& shard : _shards)
+            {
+                std::lock_guard lock{ shard.mutex };
+
+                for (auto& item : shard.q)
+                    handler(item);
+            }
+        }
+
+        template<typename U, typename F>
+            requires detail::IsVariant<T>::value
+        void forEach(F&& handler)
+        {
+            forEach([&](T& var) {
+                if (auto* value = std::get_if<U>(&var))
+                    handler(*value);
+            });
+        }
+
+        // Number of queued items holding any of Ts alternatives, scans all shards
+        template<typename... Ts>
+            requires (detail::IsVariant<T>::value && sizeof...(Ts) > 0)
+        size_t count()
+        {
+            size_t count = 0;
+
+            forEach([&](const T& value) {
+                if ((... || std::holds_alternative<Ts>(value)))
+                    ++count;
+            });
+
+            return count;
+        }
+
+        // Removes all items holding any of Ts alternatives, keeping the order of the rest
+        template<typename... Ts>
+            requires (detail::IsVariant<T>::value && sizeof...(Ts) > 0)
+        void remove()
+        {
+            size_t removed = 0;
+
+            for (auto& shard : _shards)
+            {
+                std::lock_guard lock{ shard.mutex };
+
+                auto size = shard.q.size();
+
+                std::erase_if(shard.q, [](const T& value) { return (... || std::holds_alternative<Ts>(value)); });
+
+                removed += size - shard.q.size();
+            }
+
+            if (removed == 0)
+                return;
+
+            _size.fetch_sub(removed);
+            popped(removed);
+        }
+    };
+}
@@ -2,12 +2,20 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <deque>
+#include <vector>
+#include <array>
 #include <chrono>
 #include <variant>
 #include <type_traits>
 #include <limits>
+#include <iterator>
+#include <algorithm>
 #include "timestamp.h"
 #include "strong_typedef.h"
+#include "meta.h"
+#include "atomic_wait.h"
+#include "queue_metrics.h"
 #include <concepts>
 
 #undef min
@@ -22,6 +30,46 @@ namespace mdsp
 
         template<typename... Ts>
         struct IsVariant<std::variant<Ts...>> : std::true_type {};
+
+        // Number of queued items per variant alternative, maintained on every push/pop
+        template<typename T>
+        struct AlternativeCounts
+        {
+            void added(const T&) {}
+            void removed(const T&) {}
+            void reset() {}
+        };
+
+        template<typename... Ts>
+        struct AlternativeCounts<std::variant<Ts...>>
+        {
+            using Variant = std::variant<Ts...>;
+
+            std::array<size_t, sizeof...(Ts)> counts{};
+
+            void added(const Variant& value)
+            {
+                if (!value.valueless_by_exception())
+                    ++counts[value.index()];
+            }
+
+            void removed(const Variant& value)
+            {
+                if (!value.valueless_by_exception())
+                    --counts[value.index()];
+            }
+
+            void reset()
+            {
+                counts.fill(0);
+            }
+
+            template<typename... Us>
+            size_t count() const
+            {
+                return (counts[meta::IndexOf<Variant, Us>::value] + ... + 0);
+            }
+        };
     }
 
     using ClearCache = StrongTypedef<bool, struct _ClearCacheTag>;
@@ -33,20 +81,48 @@ namespace mdsp
         Shutdown = 2
     };
 
-    template<typename T>
+    // What add() does when the queue is full
+    enum class Overflow
+    {
+        // Waits up to producerTimeout for a free slot, then rejects the item (add returns false)
+        Block,
+        // Rejects the item right away (add returns false)
+        Reject,
+        // Drops the queued item that would be dequeued next to make room, add never blocks
+        DropOldest,
+        // Drops the new item, add returns true as if it was delivered and never blocks
+        DropNewest
+    };
+
+    // Number of items the overflow policy didn't let through, counted since the queue was created
+    struct OverflowCounters
+    {
+        // Rejected by Overflow::Reject, by Overflow::Block after producerTimeout or by tryAdd on a full queue
+        uint64_t rejected = 0;
+        uint64_t droppedOldest = 0;
+        uint64_t droppedNewest = 0;
+    };
+
+    // Storage has to provide std::deque-like interface (push/pop on both ends, front/back, iteration, clear)
+    // Storages that can preallocate (like RingBuffer) are reserved to the queue capacity
+    // Metrics is NoMetrics (no instrumentation) or QueueMetrics, see backend::Instrumented
+    template<typename T, typename Storage = std::deque<T>, typename Metrics = NoMetrics>
     class SyncQueue
     {
+    public:
+        using value_type = T;
+
     protected:
         friend class Interlocked;
 
         class Interlocked
         {
         protected:
-            SyncQueue<T>& _self;
+            SyncQueue& _self;
             std::mutex& _mutex;
 
         public:
-            Interlocked(SyncQueue<T>& self, std::mutex& mutex)
+            Interlocked(SyncQueue& self, std::mutex& mutex)
                 : _self(self)
                 , _mutex(mutex)
             {
@@ -82,7 +158,7 @@ namespace mdsp
             Interlocked& clear(bool shouldClear)
             {
                 if (shouldClear)
-                    _self._q.clear();
+                    _self.clearStorage();
 
                 return *this;
             }
@@ -123,33 +199,180 @@ namespace mdsp
             }
         };
 
-        Time _producerTimeout = Time::FromSeconds(std::numeric_limits<int>::max());
-        Time _consumerTimeout = Time::FromSeconds(5);
+        // Atomic, so that the calls without a timeout don't lock just to read it
+        std::atomic<Time> _producerTimeout = Time::FromSeconds(std::numeric_limits<int>::max());
+        std::atomic<Time> _consumerTimeout = Time::FromSeconds(5);
         size_t _capacity;
 
         std::mutex _mutex;
         std::condition_variable _notFull;
         std::condition_variable _notEmpty;
         bool _shouldReceive;
+        SpinPolicy _receiveSpin;
+        Overflow _overflow = Overflow::Block;
+        OverflowCounters _overflowCounters;
+
+        Storage _q;
+        detail::AlternativeCounts<T> _counts;
+        Metrics _metrics;
 
-        std::deque<T> _q;
+        // Copy of _q.size() readable without the lock, spinning consumers poll it
+        std::atomic<size_t> _sizeHint = 0;
+
+        // Threads parked on _notEmpty/_notFull, changed under _mutex only. The notify functions skip
+        // the condition_variable (and its syscall) when nobody waits, so they must be called after
+        // the state change was made under _mutex, which every caller does
+        std::atomic<size_t> _waitingConsumers = 0;
+        std::atomic<size_t> _waitingProducers = 0;
+
+        // Set by interrupt(), makes the current (or next) consumer wait return early
+        std::atomic_bool _interrupted = false;
+
+        // Signals of WaitSets waiting on this queue, notified whenever an item is added or the queue is closed
+        std::vector<WakeSignal*> _listeners;
 
         template<typename F>
         auto whenEnqueued(F&& handler, Time timeout)
         {
             std::unique_lock lock{ _mutex };
 
-            bool timedout = false;
-
-            if (consumerShouldWait())
-                timedout = !_notEmpty.wait_for(lock, timeout.chronoMilliseconds(), [&]() { return !consumerShouldWait(); });
-
-            if (timedout || _isEmpty_impl())
+            if (!waitNotEmpty(lock, timeout) || _isEmpty_impl())
                 return;
 
             handler();
         }
 
+        // Waits up to timeout until there's an item or the queue stops receiving, returns false on timeout or interrupt()
+        // With receive spin policy set, the consumer first busy-waits with the lock released
+        bool waitNotEmpty(std::unique_lock<std::mutex>& lock, Time timeout)
+        {
+            if (!consumerShouldWait())
+                return true;
+
+            auto deadline = deadlineAfter(timeout);
+
+            if (_receiveSpin.enabled())
+            {
+                auto policy = _receiveSpin;
+
+                lock.unlock();
+                policy.spinUntil(timeout, [&]() { return _sizeHint.load(std::memory_order_acquire) != 0 || _interrupted; });
+                lock.lock();
+            }
+
+            _waitingConsumers.fetch_add(1, std::memory_order_relaxed);
+            _notEmpty.wait_until(lock, deadline, [&]() { return !consumerShouldWait() || _interrupted; });
+            _waitingConsumers.fetch_sub(1, std::memory_order_relaxed);
+
+            bool interrupted = _interrupted.exchange(false);
+
+            if (!consumerShouldWait())
+                return true;
+
+            if (!interrupted)
+                _metrics.consumerTimeout();
+
+            return false;
+        }
+
+        bool waitNotFull(std::unique_lock<std::mutex>& lock)
+        {
+            if (!producerShouldWait())
+                return true;
+
+            return waitNotFullUntil(lock, deadlineAfter(_producerTimeout));
+        }
+
+        bool waitNotFullUntil(std::unique_lock<std::mutex>& lock, std::chrono::steady_clock::time_point deadline)
+        {
+            Time start;
+
+            if constexpr (Metrics::enabled)
+                start = Time::NowSteady();
+
+            _waitingProducers.fetch_add(1, std::memory_order_relaxed);
+            bool ready = _notFull.wait_until(lock, deadline, [&]() { return !producerShouldWait(); });
+            _waitingProducers.fetch_sub(1, std::memory_order_relaxed);
+
+            if constexpr (Metrics::enabled)
+            {
+                _metrics.blocked(Time::NowSteady() - start);
+
+                if (!ready)
+                    _metrics.producerTimeout();
+            }
+
+            return ready;
+        }
+
+        // Applies the overflow policy to a full queue, returns false if the new item mustn't be added
+        // Overflow::Block only waits if mayBlock is set
+        bool makeRoom(std::unique_lock<std::mutex>& lock, bool mayBlock = true)
+        {
+            if (!producerShouldWait())
+                return true;
+
+            if (_overflow == Overflow::DropOldest)
+            {
+                while (producerShouldWait() && !_q.empty())
+                    dropOldest();
+
+                return true;
+            }
+
+            if (_overflow == Overflow::Block && mayBlock && waitNotFull(lock))
+                return true;
+
+            refuse(1);
+
+            return false;
+        }
+
+        // Storages with priorities (PriorityLanes) evict from the lowest priority, not the item dequeued next
+        void dropOldest()
+        {
+            if constexpr (requires { _q.pop_lowest_front(); })
+            {
+                _counts.removed(_q.lowest_front());
+                _q.pop_lowest_front();
+            }
+            else
+            {
+                _counts.removed(_q.front());
+                _q.pop_front();
+            }
+
+            _metrics.dropped(1, true);
+            ++_overflowCounters.droppedOldest;
+            sizeChanged();
+        }
+
+        // count new items weren't added because the queue was full
+        void refuse(size_t count)
+        {
+            if (_overflow == Overflow::DropNewest)
+            {
+                _overflowCounters.droppedNewest += count;
+                _metrics.dropped(count, false);
+            }
+            else
+            {
+                _overflowCounters.rejected += count;
+                _metrics.rejected(count);
+            }
+        }
+
+        void notifyListeners()
+        {
+            for (auto* listener : _listeners)
+                listener->notify();
+        }
+
+        void sizeChanged()
+        {
+            _sizeHint.store(_q.size(), std::memory_order_release);
+        }
+
         size_t _size_impl() const
         {
             return _q.size();
@@ -183,11 +406,133 @@ namespace mdsp
             return _shouldReceive && _isEmpty_impl();
         }
 
+        // All storage changes go through these, so the per-alternative counts stay up to date
+        template<typename... Args>
+        void pushBack(Args&&... args)
+        {
+            _metrics.enqueued(_q.size());
+            _counts.added(_q.emplace_back(std::forward<Args>(args)...));
+            sizeChanged();
+            notifyListeners();
+        }
+
+        template<typename... Args>
+        void pushFront(Args&&... args)
+        {
+            _metrics.enqueued(_q.size(), 1, true);
+            _counts.added(_q.emplace_front(std::forward<Args>(args)...));
+            sizeChanged();
+            notifyListeners();
+        }
+
+        template<typename... Args>
+        void pushTo(size_t lane, Args&&... args)
+        {
+            _metrics.enqueued(_q.size());
+            _counts.added(_q.emplace(lane, std::forward<Args>(args)...));
+            sizeChanged();
+            notifyListeners();
+        }
+
+        T popFront()
+        {
+            _counts.removed(_q.front());
+
+            T item = std::move(_q.front());
+            _q.pop_front();
+            _metrics.dequeued();
+            sizeChanged();
+
+            return item;
+        }
+
+        void clearStorage()
+        {
+            _q.clear();
+            _counts.reset();
+            _metrics.truncated(0);
+            sizeChanged();
+        }
+
+        void reserve()
+        {
+            if constexpr (requires { _q.reserve(_capacity); })
+                _q.reserve(_capacity);
+        }
+
+        // Inserts [first, last) in chunks that fit into the remaining capacity, with Overflow::Block waiting
+        // up to producerTimeout in total. Consumers are woken up once per chunk, returns the number of inserted items
+        template<typename It, typename F>
+        size_t addBulkWith(It first, It last, F&& insert)
+        {
+            std::unique_lock lock{ _mutex };
+
+            auto deadline = deadlineAfter(_producerTimeout);
+            size_t added = 0;
+
+            while (first != last)
+            {
+                if (producerShouldWait() && _overflow == Overflow::Block)
+                {
+                    if (added > 0)
+                        notifyConsumers();
+
+                    if (!waitNotFullUntil(lock, deadline))
+                        break;
+                }
+
+                if (!_shouldReceive)
+                    break;
+
+                auto count = size_t(std::distance(first, last));
+
+                if (_capacity != 0)
+                {
+                    if (_overflow == Overflow::DropOldest)
+                    {
+                        while (!_q.empty() && _q.size() + count > _capacity)
+                            dropOldest();
+                    }
+
+                    count = std::min(count, _capacity - std::min(_capacity, _q.size()));
+                }
+
+                // Full queue with Reject/DropNewest
+                if (count == 0)
+                    break;
+
+                auto chunkEnd = std::next(first, count);
+
+                insert(first, chunkEnd);
+
+                added += count;
+                first = chunkEnd;
+            }
+
+            if (auto rest = size_t(std::distance(first, last)); rest > 0)
+            {
+                if (_shouldReceive)
+                    refuse(rest);
+                else
+                    _metrics.rejected(rest);
+            }
+
+            lock.unlock();
+
+            if (added > 1)
+                notifyConsumers();
+            else if (added == 1)
+                notifyConsumer();
+
+            return added;
+        }
+
     public:
         SyncQueue(size_t capacity = 10)
             : _capacity(capacity)
             , _shouldReceive(true)
         {
+            reserve();
         }
 
         size_t size()
@@ -209,6 +554,8 @@ namespace mdsp
             std::unique_lock lock{ _mutex };
 
             _capacity = newCapacity;
+
+            reserve();
         }
 
         bool isEmpty()
@@ -227,97 +574,159 @@ namespace mdsp
 
         Time producerTimeout()
         {
-            std::unique_lock lock{ _mutex };
-
             return _producerTimeout;
         }
 
         void producerTimeout(Time timeout)
         {
-            std::unique_lock lock{ _mutex };
-
             _producerTimeout = timeout;
         }
 
         Time consumerTimeout()
         {
-            std::unique_lock lock{ _mutex };
-
             return _consumerTimeout;
         }
 
         void consumerTimeout(Time timeout)
+        {
+            _consumerTimeout = timeout;
+        }
+
+        SpinPolicy receiveSpin()
         {
             std::unique_lock lock{ _mutex };
 
-            _consumerTimeout = timeout;
+            return _receiveSpin;
+        }
+
+        Overflow overflow()
+        {
+            std::unique_lock lock{ _mutex };
+
+            return _overflow;
+        }
+
+        void overflow(Overflow policy)
+        {
+            std::unique_lock lock{ _mutex };
+
+            _overflow = policy;
+        }
+
+        OverflowCounters overflowCounters()
+        {
+            std::unique_lock lock{ _mutex };
+
+            return _overflowCounters;
+        }
+
+        void receiveSpin(SpinPolicy policy)
+        {
+            std::unique_lock lock{ _mutex };
+
+            _receiveSpin = policy;
         }
 
+        // Notifications are only sent when a producer/consumer is parked on the queue
         void notifyProducer()
         {
-            _notFull.notify_one();
+            if (_waitingProducers.load(std::memory_order_relaxed) != 0)
+                _notFull.notify_one();
         }
 
         void notifyProducers()
         {
-            _notFull.notify_all();
+            if (_waitingProducers.load(std::memory_order_relaxed) != 0)
+                _notFull.notify_all();
         }
 
         void notifyConsumer()
         {
-            _notEmpty.notify_one();
+            if (_waitingConsumers.load(std::memory_order_relaxed) != 0)
+                _notEmpty.notify_one();
         }
 
         void notifyConsumers()
         {
-            _notEmpty.notify_all();
+            if (_waitingConsumers.load(std::memory_order_relaxed) != 0)
+                _notEmpty.notify_all();
         }
 
         void notifyAll()
         {
-            _notEmpty.notify_all();
-            _notFull.notify_all();
+            notifyConsumers();
+            notifyProducers();
+        }
+
+        // Wakes up the consumer waiting in get/getWithStatus/getBulk, it returns Timeout unless an item arrived meanwhile
+        // If no consumer is waiting, the next wait returns right away
+        void interrupt()
+        {
+            std::unique_lock lock{ _mutex };
+
+            _interrupted = true;
+
+            lock.unlock();
+            notifyConsumers();
         }
 
         void clear()
         {
             std::unique_lock lock{ _mutex };
 
-            _q.clear();
+            clearStorage();
 
             lock.unlock();
             notifyAll();
         }
 
+        // Number of queued items holding any of Ts alternatives, no scan is needed
         template<typename... Ts>
             requires (detail::IsVariant<T>::value && sizeof...(Ts) > 0)
-        void remove()
+        size_t count()
         {
             std::unique_lock lock{ _mutex };
 
-            std::deque<T> copies;
+            return _counts.template count<Ts...>();
+        }
 
-            while (!_isEmpty_impl())
-            {
-                auto value = std::move(_q.front());
-                _q.pop_front();
+        // Removes all items holding any of Ts alternatives in place, keeping the order of the rest
+        template<typename... Ts>
+            requires (detail::IsVariant<T>::value && sizeof...(Ts) > 0)
+        void remove()
+        {
+            std::unique_lock lock{ _mutex };
+
+            if (_counts.template count<Ts...>() == 0)
+                return;
 
+            auto matches = [&](const T& value) {
                 if (!(... || std::holds_alternative<Ts>(value)))
-                    copies.push_back(std::move(value));
-            }
+                    return false;
 
-            while (!copies.empty())
-            {
-                auto value = std::move(copies.front());
-                copies.pop_front();
+                _counts.removed(value);
+                return true;
+            };
 
-                _q.push_back(std::move(value));
-            }
+            if constexpr (requires { _q.erase_if(matches); })
+                _q.erase_if(matches);
+            else
+                _q.erase(std::remove_if(_q.begin(), _q.end(), matches), _q.end());
+
+            _metrics.truncated(_q.size());
+            sizeChanged();
 
             lock.unlock();
             notifyAll();
         }
 
+        bool shouldReceive()
+        {
+            std::unique_lock lock{ _mutex };
+
+            return _shouldReceive;
+        }
+
         void shouldReceive(bool value, ClearCache shouldClear = ClearCache(true))
         {
             std::unique_lock lock{ _mutex };
@@ -325,77 +734,170 @@ namespace mdsp
             _shouldReceive = value;
 
             if (shouldClear)
-                _q.clear();
+                clearStorage();
+
+            notifyListeners();
 
             lock.unlock();
             notifyAll();
         }
 
+        // Returns whether the item was accepted: queued, or discarded by Overflow::DropNewest.
+        // false if the queue stopped receiving or there was no room within producerTimeout (same for addFront, addTo and tryAdd)
         bool add(T item)
         {
             std::unique_lock lock{ _mutex };
 
-            if (producerShouldWait())
-                _notFull.wait_for(lock, _producerTimeout.chronoMilliseconds(), [&]() { return !producerShouldWait(); });
+            if (!makeRoom(lock))
+                return _overflow == Overflow::DropNewest;
 
             if (!_shouldReceive)
+            {
+                _metrics.rejected();
                 return false;
+            }
 
-            _q.push_back(std::move(item));
+            pushBack(std::move(item));
 
             lock.unlock();
             notifyConsumer();
 
-            return !_isEmpty_impl();
+            return true;
         }
 
         bool addFront(T item)
         {
             std::unique_lock lock{ _mutex };
 
-            if (producerShouldWait())
-                _notFull.wait_for(lock, _producerTimeout.chronoMilliseconds(), [&]() { return !producerShouldWait(); });
+            if (!makeRoom(lock))
+                return _overflow == Overflow::DropNewest;
 
             if (!_shouldReceive)
+            {
+                _metrics.rejected();
                 return false;
+            }
 
-            _q.push_front(std::move(item));
+            pushFront(std::move(item));
 
             lock.unlock();
             notifyConsumer();
 
-            return !_isEmpty_impl();
+            return true;
+        }
+
+        template<typename It>
+        size_t addBulk(It first, It last)
+        {
+            return addBulkWith(first, last, [&](It from, It to) {
+                for (; from != to; ++from)
+                    pushBack(*from);
+            });
+        }
+
+        // Inserts the items in front of the queue, keeping their relative order within each inserted chunk
+        // If the batch doesn't fit at once, the rest is inserted in front once there's room, i.e. ahead of
+        // the earlier chunk if it's still queued (PriorityLanes append every chunk to lane 0, so the order is kept there)
+        template<typename It>
+        size_t addFrontBulk(It first, It last)
+        {
+            return addBulkWith(first, last, [&](It from, It to) {
+                auto count = std::distance(from, to);
+
+                _metrics.enqueued(_q.size(), size_t(count), true);
+
+                auto it = _q.insert(_q.begin(), from, to);
+
+                for (; count > 0; --count, ++it)
+                    _counts.added(*it);
+
+                sizeChanged();
+                notifyListeners();
+            });
+        }
+
+        // Adds the item to the back of the given lane, only for storages with multiple lanes (PriorityLanes)
+        bool addTo(size_t lane, T item)
+            requires requires (Storage storage, T value) { storage.push(size_t(0), std::move(value)); }
+        {
+            std::unique_lock lock{ _mutex };
+
+            if (!makeRoom(lock))
+                return _overflow == Overflow::DropNewest;
+
+            if (!_shouldReceive)
+            {
+                _metrics.rejected();
+                return false;
+            }
+
+            pushTo(lane, std::move(item));
+
+            lock.unlock();
+            notifyConsumer();
+
+            return true;
+        }
+
+        template<typename It>
+        size_t addBulkTo(size_t lane, It first, It last)
+            requires requires (Storage storage, It it) { storage.emplace(size_t(0), *it); }
+        {
+            return addBulkWith(first, last, [&](It from, It to) {
+                for (; from != to; ++from)
+                    pushTo(lane, *from);
+            });
+        }
+
+        // Makes the queue notify listener whenever an item is added or the queue is closed
+        void attach(WakeSignal& listener)
+        {
+            std::unique_lock lock{ _mutex };
+
+            _listeners.push_back(&listener);
+        }
+
+        void detach(WakeSignal& listener)
+        {
+            std::unique_lock lock{ _mutex };
+
+            std::erase(_listeners, &listener);
         }
 
         bool tryAdd(T& item)
         {
             std::unique_lock lock{ _mutex, std::try_to_lock };
 
-            if (!lock || !_shouldReceive || _isFull_impl())
+            if (!lock)
                 return false;
 
-            _q.push_back(std::move(item));
+            if (!_shouldReceive)
+            {
+                _metrics.rejected();
+                return false;
+            }
+
+            if (!makeRoom(lock, false))
+                return _overflow == Overflow::DropNewest;
+
+            pushBack(std::move(item));
 
             lock.unlock();
             notifyConsumer();
 
-            return !_isEmpty_impl();
+            return true;
         }
 
         T get()
         {
             std::unique_lock lock{ _mutex };
 
-            bool timedout = false;
-
-            if (consumerShouldWait())
-                timedout = !_notEmpty.wait_for(lock, _consumerTimeout.chronoMilliseconds(), [&]() { return !consumerShouldWait(); });
+            bool timedout = !waitNotEmpty(lock, _consumerTimeout);
 
             if (timedout || _isEmpty_impl())
                 return {};
 
-            auto item = std::move(_q.front());
-            _q.pop_front();
+            auto item = popFront();
 
             lock.unlock();
             notifyProducer();
@@ -403,20 +905,16 @@ namespace mdsp
             return item;
         }
 
-        std::pair<SyncQStatus, T> getWithStatus()
+        std::pair<SyncQStatus, T> getWithStatus(Time timeout)
         {
             std::unique_lock lock{ _mutex };
 
-            bool timedout = false;
-
-            if (consumerShouldWait())
-                timedout = !_notEmpty.wait_for(lock, _consumerTimeout.chronoMilliseconds(), [&]() { return !consumerShouldWait(); });
+            bool timedout = !waitNotEmpty(lock, timeout);
 
             if (timedout || _isEmpty_impl())
                 return { !_shouldReceive ? SyncQStatus::Shutdown : SyncQStatus::Timeout, T{} };
 
-            auto item = std::move(_q.front());
-            _q.pop_front();
+            auto item = popFront();
 
             lock.unlock();
             notifyProducer();
@@ -424,6 +922,59 @@ namespace mdsp
             return { SyncQStatus::OK, std::move(item) };
         }
 
+        std::pair<SyncQStatus, T> getWithStatus()
+        {
+            return getWithStatus(_consumerTimeout);
+        }
+
+        // Waits for the queue to become non-empty, then moves up to maxN items into out under a single lock
+        // Returns the status and the number of items written, producers are woken up once for the whole batch
+        template<typename OutputIt>
+        std::pair<SyncQStatus, size_t> getBulk(OutputIt out, size_t maxN, Time timeout)
+        {
+            std::unique_lock lock{ _mutex };
+
+            bool timedout = !waitNotEmpty(lock, timeout);
+
+            if (timedout || _isEmpty_impl())
+                return { !_shouldReceive ? SyncQStatus::Shutdown : SyncQStatus::Timeout, 0 };
+
+            size_t count = 0;
+
+            for (; count < maxN && !_isEmpty_impl(); ++count)
+            {
+                *out = popFront();
+                ++out;
+            }
+
+            lock.unlock();
+            notifyProducers();
+
+            return { SyncQStatus::OK, count };
+        }
+
+        template<typename OutputIt>
+        std::pair<SyncQStatus, size_t> getBulk(OutputIt out, size_t maxN)
+        {
+            return getBulk(out, maxN, _consumerTimeout);
+        }
+
+        // Non-blocking get that waits for the lock, unlike tryGet it never misses a queued item
+        bool poll(T& item)
+        {
+            std::unique_lock lock{ _mutex };
+
+            if (_isEmpty_impl())
+                return false;
+
+            item = popFront();
+
+            lock.unlock();
+            notifyProducer();
+
+            return true;
+        }
+
         bool tryGet(T& item)
         {
             std::unique_lock lock{ _mutex, std::try_to_lock };
@@ -431,8 +982,7 @@ namespace mdsp
             if (!lock || _isEmpty_impl())
                 return false;
 
-            item = std::move(_q.front());
-            _q.pop_front();
+            item = popFront();
 
             lock.unlock();
             notifyProducer();
@@ -473,6 +1023,9 @@ namespace mdsp
         {
             std::unique_lock lock{ _mutex };
 
+            if (_counts.template count<U>() == 0)
+                return;
+
             for (auto& var : _q)
             {
                 if (!std::holds_alternative<U>(var))
@@ -487,14 +1040,39 @@ namespace mdsp
             }
         }
 
+        // Calls the handler with the newest queued U alternative in O(1), returns false if there's none
+        // Only for storages that keep track of it (CoalescingIndex)
+        template<typename U, typename F>
+            requires requires (Storage storage) { storage.template latest<U>(); }
+        bool latest(F&& handler)
+        {
+            std::unique_lock lock{ _mutex };
+
+            auto* value = _q.template latest<U>();
+
+            if (!value)
+                return false;
+
+            handler(*value);
+
+            return true;
+        }
+
+        // Lock-free snapshot of the queue metrics, only with QueueMetrics instrumentation
+        QueueMetricsSnapshot metrics() const
+            requires Metrics::enabled
+        {
+            return _metrics.snapshot();
+        }
+
         Interlocked lock()
         {
             return Interlocked{ *this, _mutex };
         }
     };
 
-    template<typename... Ts>
-    auto forEachQ(SyncQueue<Ts>&... ts)
+    template<typename... Ts, typename... Storages, typename... Metrics>
+    auto forEachQ(SyncQueue<Ts, Storages, Metrics>&... ts)
     {
         return [&](auto&& handler)
         {
@@ -0,0 +1,407 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <bit>
+#include <utility>
+#include <algorithm>
+#include "timestamp.h"
+
+namespace mdsp
+{
+    // Identifies a timer in TimerWheel, stays invalid after the timer fired (one-shot) or was cancelled
+    struct TimerId
+    {
+        uint32_t index = UINT32_MAX;
+        uint32_t generation = 0;
+
+        bool valid() const
+        {
+            return index != UINT32_MAX;
+        }
+    };
+
+    // Hierarchical timer wheel holding items of type T until their deadline (mdsp::Time on the steady clock, see Time::NowSteady).
+    // Time is split into ticks of the given resolution, deadlines are rounded up to a whole tick, so timers never fire early.
+    //
+    // 4 levels of 256 slots cover 2^32 ticks (~49 days with 1 ms resolution), later deadlines are kept in the last level
+    // and moved down as the wheel turns. Timers are intrusive doubly-linked list nodes stored in a vector with a free list,
+    // so add() and cancel() are O(1) and don't allocate once the vector has grown. advance() skips empty slots
+    // using per-level bitmasks of non-empty slots.
+    //
+    // Not thread-safe, the owner has to synchronize access.
+    //
+    // Example:
+    //      TimerWheel<Command> timers;
+    //      auto id = timers.add(Time::NowSteady() + 40_ms, Command{});
+    //      timers.advance(Time::NowSteady(), [](auto&& cmd) { ... });
+    //
+    template<typename T>
+    class TimerWheel
+    {
+    protected:
+        static constexpr size_t Levels = 4;
+        static constexpr size_t SlotBits = 8;
+        static constexpr size_t Slots = size_t(1) << SlotBits;
+        static constexpr uint64_t SlotMask = Slots - 1;
+        static constexpr uint32_t None = UINT32_MAX;
+
+        struct Node
+        {
+            std::optional<T> item;
+            Time deadline;
+            Time period;
+            uint64_t expiry = 0;
+            uint32_t generation = 0;
+            uint32_t prev = None;
+            uint32_t next = None;
+            uint32_t slot = None;
+        };
+
+        Time _origin;
+        Time _resolution;
+
+        // Next tick to be processed, all timers expiring before it have fired
+        uint64_t _now = 0;
+
+        std::vector<Node> _nodes;
+        uint32_t _free = None;
+        size_t _size = 0;
+
+        std::array<uint32_t, Levels * Slots> _slots;
+        std::array<std::array<uint64_t, Slots / 64>, Levels> _occupied{};
+
+        uint64_t ticksUntil(Time time) const
+        {
+            auto elapsed = (time - _origin).template repr<int64_t>();
+            auto resolution = _resolution.template repr<int64_t>();
+
+            if (elapsed <= 0)
+                return 0;
+
+            return uint64_t((elapsed + resolution - 1) / resolution);
+        }
+
+        Time timeOf(uint64_t tick) const
+        {
+            return _origin + _resolution * int64_t(tick);
+        }
+
+        void link(uint32_t index)
+        {
+            auto& node = _nodes[index];
+            uint64_t expiry = (std::max)(node.expiry, _now);
+            uint64_t delta = expiry - _now;
+
+            size_t level = 0;
+
+            while (level + 1 < Levels && delta >= (uint64_t(1) << (SlotBits * (level + 1))))
+                ++level;
+
+            // Deadlines past the last level are parked in its furthest slot and re-linked when it's reached
+            if (level == Levels - 1 && delta >> (SlotBits * Levels))
+                expiry = _now + (uint64_t(1) << (SlotBits * Levels)) - 1;
+
+            size_t slot = level * Slots + ((expiry >> (SlotBits * level)) & SlotMask);
+
+            node.slot = uint32_t(slot);
+            node.prev = None;
+            node.next = _slots[slot];
+
+            if (node.next != None)
+                _nodes[node.next].prev = index;
+
+            _slots[slot] = index;
+            _occupied[level][(slot % Slots) / 64] |= uint64_t(1) << (slot % 64);
+        }
+
+        void unlink(uint32_t index)
+        {
+            auto& node = _nodes[index];
+
+            if (node.prev != None)
+                _nodes[node.prev].next = node.next;
+            else
+                _slots[node.slot] = node.next;
+
+            if (node.next != None)
+                _nodes[node.next].prev = node.prev;
+
+            if (_slots[node.slot] == None)
+            {
+                size_t level = node.slot / Slots;
+                size_t slot = node.slot % Slots;
+
+                _occupied[level][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+            }
+
+            node.slot = None;
+        }
+
+        void release(uint32_t index)
+        {
+            auto& node = _nodes[index];
+
+            node.item.reset();
+            ++node.generation;
+            node.next = _free;
+            _free = index;
+
+            --_size;
+        }
+
+        // Detaches the whole slot list, returns its first node
+        uint32_t take(size_t level, size_t slot)
+        {
+            uint32_t head = _slots[level * Slots + slot];
+
+            _slots[level * Slots + slot] = None;
+            _occupied[level][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+
+            for (uint32_t index = head; index != None; index = _nodes[index].next)
+                _nodes[index].slot = None;
+
+            return head;
+        }
+
+        // Moves the timers of the current slot of level down to the lower levels
+        void cascade(size_t level)
+        {
+            uint32_t index = take(level, (_now >> (SlotBits * level)) & SlotMask);
+
+            while (index != None)
+            {
+                uint32_t next = _nodes[index].next;
+                link(index);
+                index = next;
+            }
+        }
+
+        // Whether any timer waits in levels above 0
+        bool cascading() const
+        {
+            for (size_t level = 1; level < Levels; ++level)
+            {
+                for (auto bits : _occupied[level])
+                {
+                    if (bits)
+                        return true;
+                }
+            }
+
+            return false;
+        }
+
+        // First occupied slot of level at or after from (no wrap-around), Slots if there's none
+        size_t nextOccupied(size_t level, size_t from) const
+        {
+            for (size_t word = from / 64; word < Slots / 64; ++word)
+            {
+                uint64_t bits = _occupied[level][word];
+
+                if (word == from / 64)
+                    bits &= ~uint64_t(0) << (from % 64);
+
+                if (bits)
+                    return word * 64 + size_t(std::countr_zero(bits));
+            }
+
+            return Slots;
+        }
+
+    public:
+        explicit TimerWheel(Time resolution = Time::FromMilliseconds(1), Time origin = Time::NowSteady())
+            : _origin(origin)
+            , _resolution(resolution)
+        {
+            _slots.fill(None);
+        }
+
+        size_t size() const
+        {
+            return _size;
+        }
+
+        bool empty() const
+        {
+            return _size == 0;
+        }
+
+        Time resolution() const
+        {
+            return _resolution;
+        }
+
+        // Adds a timer firing at deadline, with period != 0 it fires again every period after that
+        TimerId add(Time deadline, T item, Time period = Time::Zero())
+        {
+            uint32_t index = _free;
+
+            if (index != None)
+            {
+                _free = _nodes[index].next;
+            }
+            else
+            {
+                index = uint32_t(_nodes.size());
+                _nodes.emplace_back();
+            }
+
+            auto& node = _nodes[index];
+
+            node.item.emplace(std::move(item));
+            node.deadline = deadline;
+            node.period = period;
+            node.expiry = ticksUntil(deadline);
+
+            link(index);
+            ++_size;
+
+            return { index, node.generation };
+        }
+
+        // Returns false if the timer has already fired (one-shot) or was cancelled
+        bool cancel(TimerId id)
+        {
+            if (id.index >= _nodes.size())
+                return false;
+
+            auto& node = _nodes[id.index];
+
+            if (node.generation != id.generation || !node.item)
+                return false;
+
+            if (node.slot != None)
+                unlink(id.index);
+
+            release(id.index);
+
+            return true;
+        }
+
+        // Earliest time advance() has to be called at, it can be earlier than the actual deadline
+        // when the nearest timers are still kept in the higher levels
+        std::optional<Time> nextDeadline() const
+        {
+            if (_size == 0)
+                return std::nullopt;
+
+            size_t index0 = _now & SlotMask;
+
+            // Higher levels are cascaded when the next level 0 round starts, at _now
+            if (index0 == 0 && cascading())
+                return timeOf(_now);
+
+            size_t slot = nextOccupied(0, index0);
+
+            if (slot != Slots)
+                return timeOf((_now & ~SlotMask) + slot);
+
+            // Next level 0 round, the higher levels are cascaded there
+            return timeOf((_now | SlotMask) + 1);
+        }
+
+        // Fires all timers with deadline <= now, calling handler(T&) for periodic timers and handler(T&&) for one-shot ones,
+        // which are released right after, so the handler can move them out. Periodic timers are re-armed
+        // after the handler, missed periods are skipped. handler must not add or cancel timers,
+        // it should collect the items and process them after advance() returns.
+        template<typename F>
+        size_t advance(Time now, F&& handler)
+        {
+            // Ticks that have fully elapsed by now
+            auto elapsed = (now - _origin).template repr<int64_t>();
+            uint64_t target = elapsed < 0 ? 0 : uint64_t(elapsed / _resolution.template repr<int64_t>());
+            size_t fired = 0;
+
+            while (_now <= target)
+            {
+                if (_size == 0)
+                {
+                    _now = target + 1;
+                    break;
+                }
+
+                size_t index0 = _now & SlotMask;
+
+                if (index0 == 0)
+                {
+                    for (size_t level = Levels - 1; level > 0; --level)
+                    {
+                        if ((_now & ((uint64_t(1) << (SlotBits * level)) - 1)) == 0)
+                            cascade(level);
+                    }
+                }
+
+                // Skip to the next occupied slot within this level 0 round
+                size_t slot = nextOccupied(0, index0);
+
+                if (slot == Slots)
+                {
+                    _now = (std::min)((_now | SlotMask) + 1, target + 1);
+                    continue;
+                }
+
+                uint64_t tick = (_now & ~SlotMask) + slot;
+
+                if (tick > target)
+                {
+                    _now = target + 1;
+                    break;
+                }
+
+                _now = tick;
+
+                uint32_t index = take(0, slot);
+
+                while (index != None)
+                {
+                    auto& node = _nodes[index];
+                    uint32_t next = node.next;
+
+                    if (node.period > Time::Zero())
+                        handler(*node.item);
+                    else
+                        handler(std::move(*node.item));
+
+                    ++fired;
+
+                    if (node.period > Time::Zero())
+                    {
+                        node.deadline += node.period;
+
+                        if (node.deadline <= now)
+                            node.deadline += node.period * ((now - node.deadline).template repr<int64_t>() / node.period.template repr<int64_t>() + 1);
+
+                        node.expiry = ticksUntil(node.deadline);
+                        link(index);
+                    }
+                    else
+                    {
+                        release(index);
+                    }
+
+                    index = next;
+                }
+
+                ++_now;
+            }
+
+            return fired;
+        }
+
+        void clear()
+        {
+            for (uint32_t index = 0; index < _nodes.size(); ++index)
+            {
+                if (_nodes[index].item)
+                {
+                    if (_nodes[index].slot != None)
+                        unlink(index);
+
+                    release(index);
+                }
+            }
+        }
+    };
+}
@@ -221,6 +221,12 @@ namespace mdsp
             return Time{ std::chrono::high_resolution_clock::now().time_since_epoch() };
         }
 
+        // Monotonic time (std::chrono::steady_clock), for deadlines and intervals
+        static Time NowSteady()
+        {
+            return Time{ std::chrono::steady_clock::now().time_since_epoch() };
+        }
+
         static constexpr Time Zero()
         {
             return Time{ Representation(0) };
@@ -0,0 +1,166 @@
+#pragma once
+#include <tuple>
+#include <utility>
+#include <optional>
+#include <type_traits>
+#include "timestamp.h"
+#include "atomic_wait.h"
+#include "sync_queue.h"
+
+namespace mdsp
+{
+    enum class SelectOrder
+    {
+        // Round-robin, the search starts after the queue served last, so a busy queue can't starve the others
+        Fair,
+        // The first ready queue in the WaitSet order wins
+        Priority
+    };
+
+    namespace detail
+    {
+        // Channel's queue, or the queue itself
+        template<typename Source>
+        auto& queueOf(Source& source)
+        {
+            if constexpr (requires { source.q; })
+                return source.q;
+            else
+                return source;
+        }
+
+        template<typename Source>
+        using QueueOf = std::remove_reference_t<decltype(queueOf(std::declval<Source&>()))>;
+    }
+
+    // Blocks on several queues (SyncQueue/LockFreeQueue, of any message type) at once and hands over
+    // the first available item to its queue's handler. The consumer parks on a single WakeSignal
+    // the queues notify, so an idle WaitSet doesn't poll.
+    //
+    // Queues have to outlive the WaitSet, it's attached to them for its whole lifetime.
+    // Only one thread can wait on a WaitSet at a time.
+    //
+    // Example:
+    //      auto waitSet = makeWaitSet(SelectOrder::Priority, commands, frames);
+    //
+    //      while (waitSet.select(1_s,
+    //          [&](Command&& cmd) { ... },
+    //          [&](Frame&& frame) { ... }) != SyncQStatus::Shutdown) {}
+    //
+    template<typename... Queues>
+    class WaitSet
+    {
+    protected:
+        static constexpr size_t Count = sizeof...(Queues);
+
+        std::tuple<Queues&...> _queues;
+        SelectOrder _order;
+        size_t _next = 0;
+        WakeSignal _signal;
+
+        template<size_t I, typename F>
+        bool pollOne(F& handler)
+        {
+            auto& q = std::get<I>(_queues);
+            typename std::remove_reference_t<decltype(q)>::value_type item;
+
+            if (!q.poll(item))
+                return false;
+
+            handler(std::move(item));
+            return true;
+        }
+
+        template<typename Handlers, size_t... Is>
+        bool pollAt(size_t index, Handlers& handlers, std::index_sequence<Is...>)
+        {
+            bool polled = false;
+
+            (void)((Is == index && (polled = pollOne<Is>(std::get<Is>(handlers)), true)) || ...);
+
+            return polled;
+        }
+
+        // All queues stopped receiving and have nothing left
+        bool closed()
+        {
+            return std::apply([](auto&... q) {
+                return (... && (!q.shouldReceive() && q.isEmpty()));
+            }, _queues);
+        }
+
+    public:
+        explicit WaitSet(SelectOrder order, Queues&... queues)
+            : _queues(queues...)
+            , _order(order)
+        {
+            (queues.attach(_signal), ...);
+        }
+
+        WaitSet(const WaitSet&) = delete;
+        WaitSet& operator=(const WaitSet&) = delete;
+
+        ~WaitSet()
+        {
+            std::apply([&](auto&... q) { (q.detach(_signal), ...); }, _queues);
+        }
+
+        // Waits up to timeout for an item in any queue and passes it to the handler at the queue's position
+        // Returns OK when an item was handled, Timeout, or Shutdown once all queues are closed and drained
+        // Time::Max() (or any timeout reaching past it) waits without a deadline
+        template<typename... Handlers>
+            requires (sizeof...(Handlers) == Count)
+        SyncQStatus select(Time timeout, Handlers&&... handlers)
+        {
+            auto all = std::forward_as_tuple(handlers...);
+            auto now = Time::NowSteady();
+            auto deadline = timeout >= Time::Max() - now ? Time::Max() : now + timeout;
+
+            while (true)
+            {
+                auto seen = _signal.sequence();
+
+                for (size_t i = 0; i < Count; ++i)
+                {
+                    size_t index = _order == SelectOrder::Fair ? (_next + i) % Count : i;
+
+                    if (pollAt(index, all, std::index_sequence_for<Queues...>()))
+                    {
+                        _next = index + 1;
+                        return SyncQStatus::OK;
+                    }
+                }
+
+                if (closed())
+                    return SyncQStatus::Shutdown;
+
+                auto remaining = deadline == Time::Max() ? Time::Max() : deadline - Time::NowSteady();
+
+                if (remaining <= Time::Zero())
+                    return SyncQStatus::Timeout;
+
+                _signal.wait(seen, remaining);
+            }
+        }
+
+        // Handles everything that's already queued without blocking, returns the number of handled items
+        template<typename... Handlers>
+            requires (sizeof...(Handlers) == Count)
+        size_t drain(Handlers&&... handlers)
+        {
+            size_t handled = 0;
+
+            while (select(Time::Zero(), handlers...) == SyncQStatus::OK)
+                ++handled;
+
+            return handled;
+        }
+    };
+
+    // WaitSet over Channels and/or queues
+    template<typename... Sources>
+    WaitSet<detail::QueueOf<Sources>...> makeWaitSet(SelectOrder order, Sources&... sources)
+    {
+        return WaitSet<detail::QueueOf<Sources>...>(order, detail::queueOf(sources)...);
+    }
+}
@@ -1,21 +1,35 @@
 #pragma once
+#include "atomic_wait.h"
 #include "awaitable.h"
+#include "boxed.h"
+#include "broadcast.h"
 #include "channel.h"
+#include "coalescing_index.h"
 #include "config_builder.h"
 #include "coordinate.h"
+#include "coroutine.h"
 #include "count_condition.h"
 #include "enum_bitmask.h"
 #include "geo_convert.h"
+#include "lock_free_queue.h"
 #include "mdsp_nan.h"
 #include "mdsp_types.h"
 #include "meta.h"
+#include "object_pool.h"
+#include "priority_lanes.h"
+#include "queue_backend.h"
+#include "queue_metrics.h"
+#include "ring_buffer.h"
+#include "sharded_queue.h"
 #include "static_mx.h"
 #include "static_vec.h"
 #include "strong_typedef.h"
 #include "sync_queue.h"
+#include "timer_wheel.h"
 #include "timestamp.h"
 #include "value_match.h"
 #include "variant_match.h"
+#include "wait_set.h"
 
 namespace cisim
 {
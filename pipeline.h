@@ -0,0 +1,526 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <optional>
+#include <memory>
+#include <vector>
+#include <string>
+#include <type_traits>
+#include "mdsp_common/channel.h"
+#include "thread_affinity.h"
+
+namespace cisim
+{
+    struct StageConfig
+    {
+        // Threads running the stage function, results are still passed on in input order
+        size_t workers = 1ull;
+
+        // Capacity of the stage output channel, once it's full the stage waits for the next one (backpressure)
+        size_t capacity = 16ull;
+
+        // Name of the worker threads
+        std::string name;
+
+        [[nodiscard]]
+        StageConfig withWorkers(size_t count)
+        {
+            auto config = *this;
+            config.workers = count;
+
+            return config;
+        }
+
+        [[nodiscard]]
+        StageConfig withCapacity(size_t size)
+        {
+            auto config = *this;
+            config.capacity = size;
+
+            return config;
+        }
+
+        [[nodiscard]]
+        StageConfig withName(std::string stageName)
+        {
+            auto config = *this;
+            config.name = std::move(stageName);
+
+            return config;
+        }
+    };
+
+    struct StageStats
+    {
+        std::string name;
+        size_t workers = 0;
+
+        uint64_t processed = 0;
+
+        // Items the stage function returned std::nullopt for, they aren't passed on
+        uint64_t filtered = 0;
+
+        // Time spent in the stage function, summed over all items
+        Time busy = Time::Zero();
+        Time maxBusy = Time::Zero();
+
+        // Time items waited in the stage input channel, summed over all items
+        Time waiting = Time::Zero();
+
+        // Time since the pipeline started
+        Time elapsed = Time::Zero();
+
+        Time meanBusy() const
+        {
+            return processed > 0 ? busy / int64_t(processed) : Time::Zero();
+        }
+
+        Time meanWait() const
+        {
+            return processed > 0 ? waiting / int64_t(processed) : Time::Zero();
+        }
+
+        // Processed items per second
+        double throughput() const
+        {
+            auto seconds = elapsed.seconds<double>();
+
+            return seconds > 0 ? double(processed) / seconds : 0.0;
+        }
+    };
+
+    namespace detail
+    {
+        template<typename T>
+        struct Envelope
+        {
+            // Position in the stream, dense per channel, so that parallel workers can restore the order
+            uint64_t sequence = 0;
+            T value{};
+            Time enqueued = Time::Zero();
+        };
+
+        template<typename T>
+        using Pipe = Channel<Envelope<T>>;
+
+        template<typename T>
+        std::shared_ptr<Pipe<T>> openPipe(size_t capacity)
+        {
+            auto pipe = std::make_shared<Pipe<T>>();
+
+            // Senders wait as long as it takes, backpressure has to reach the pipeline input.
+            // Receivers block too, closing the pipe wakes them up.
+            pipe->open(ChannelConfig{}
+                .withCapacity(capacity)
+                .withSendTimeout(Time::Max())
+                .withRecvTimeout(Time::Max()));
+
+            return pipe;
+        }
+
+        // Stops accepting items, but leaves the queued ones to the receivers, which get Shutdown once it's empty
+        template<typename T>
+        void closePipe(Pipe<T>& pipe)
+        {
+            pipe.q.shouldReceive(false, ClearCache(false));
+        }
+
+        template<typename T>
+        struct Unwrap
+        {
+            using type = T;
+        };
+
+        template<typename T>
+        struct Unwrap<std::optional<T>>
+        {
+            using type = T;
+        };
+
+        // Pipeline entry, shared by all Pipeline types built from it by then()
+        template<typename In>
+        struct PipelineInput
+        {
+            std::mutex mutex;
+            uint64_t sequence = 0;
+            std::shared_ptr<Pipe<In>> pipe;
+        };
+
+        class StageBase
+        {
+        public:
+            virtual ~StageBase() = default;
+
+            virtual void start() = 0;
+
+            // Waits until all workers have finished, returns false on timeout
+            virtual bool wait(Time timeout) = 0;
+
+            // Closes the channels dropping their items and releases blocked workers
+            virtual void abort() = 0;
+
+            virtual void join() = 0;
+
+            virtual StageStats stats() = 0;
+        };
+    }
+
+    // Pipeline unit running function(In&&) -> Out (or std::optional<Out> to filter items out) on its worker threads.
+    // Items are taken from the input channel by any free worker, a reorder buffer passes the results on in input order.
+    // Stages are created by Pipeline::then.
+    //
+    // Workers are plain std::threads rather than cisim::Thread: a Thread owns its channel and is its only consumer,
+    // while the workers of a stage share one input channel, and the end of the stream is passed on by closing
+    // the channels (receivers drain them and get Shutdown) instead of stop()/drain() on each thread.
+    template<typename In, typename Out>
+    class Stage
+        : public detail::StageBase
+    {
+    public:
+        using Function = std::function<std::optional<Out>(In&&)>;
+
+    protected:
+        struct Slot
+        {
+            bool ready = false;
+            std::optional<Out> value;
+        };
+
+        StageConfig _config;
+        Function _function;
+
+        std::shared_ptr<detail::Pipe<In>> _input;
+        std::shared_ptr<detail::Pipe<Out>> _output;
+
+        std::vector<std::thread> _workers;
+
+        // Reorder buffer, a worker can run at most _slots.size() items ahead of the oldest unfinished one
+        std::mutex _mutex;
+        std::condition_variable _window;
+        std::vector<Slot> _slots;
+        uint64_t _next = 0;
+        uint64_t _sent = 0;
+        bool _aborted = false;
+
+        // Separate from _mutex, which a worker holds while it waits for room in the output
+        std::mutex _stateMutex;
+        std::condition_variable _finished;
+        size_t _running = 0;
+        StageStats _stats;
+        Time _started = Time::Zero();
+        Time _stopped = Time::Zero();
+
+        void work()
+        {
+            // Naming is cosmetic, failures are ignored
+            setCurrentThreadName(_config.name);
+
+            while (true)
+            {
+                auto [status, item] = _input->recv();
+
+                if (status == SyncQStatus::Shutdown)
+                    break;
+
+                if (status != SyncQStatus::OK)
+                    continue;
+
+                auto dequeued = Time::NowSteady();
+
+                {
+                    std::unique_lock lock{ _mutex };
+
+                    _window.wait(lock, [&]() { return item.sequence < _next + _slots.size() || _aborted; });
+
+                    if (_aborted)
+                        break;
+                }
+
+                auto result = _function(std::move(item.value));
+
+                complete(item.sequence, std::move(result), dequeued - item.enqueued, Time::NowSteady() - dequeued);
+            }
+
+            std::unique_lock lock{ _stateMutex };
+
+            // The last worker passes the end of the stream on, the next stage drains what's left and stops too
+            if (--_running == 0)
+            {
+                _stopped = Time::NowSteady();
+                detail::closePipe(*_output);
+                _finished.notify_all();
+            }
+        }
+
+        void complete(uint64_t sequence, std::optional<Out> result, Time waited, Time busy)
+        {
+            {
+                std::unique_lock lock{ _stateMutex };
+
+                ++_stats.processed;
+                _stats.waiting += waited;
+                _stats.busy += busy;
+                _stats.maxBusy = (std::max)(_stats.maxBusy, busy);
+
+                if (!result)
+                    ++_stats.filtered;
+            }
+
+            std::unique_lock lock{ _mutex };
+
+            auto& slot = _slots[sequence % _slots.size()];
+
+            slot.ready = true;
+            slot.value = std::move(result);
+
+            // Sending under the lock keeps the order, a full output channel stops all workers of the stage
+            for (auto* head = &_slots[_next % _slots.size()]; head->ready; head = &_slots[_next % _slots.size()])
+            {
+                if (head->value)
+                    _output->q.add(detail::Envelope<Out>{ _sent++, std::move(*head->value), Time::NowSteady() });
+
+                head->ready = false;
+                head->value.reset();
+                ++_next;
+            }
+
+            lock.unlock();
+            _window.notify_all();
+        }
+
+    public:
+        Stage(const StageConfig& config, Function function, std::shared_ptr<detail::Pipe<In>> input, std::shared_ptr<detail::Pipe<Out>> output)
+            : _config(config)
+            , _function(std::move(function))
+            , _input(std::move(input))
+            , _output(std::move(output))
+            , _slots((std::max)(config.workers, size_t(1)) * 2)
+        {
+            _config.workers = (std::max)(config.workers, size_t(1));
+            _stats.name = _config.name;
+            _stats.workers = _config.workers;
+        }
+
+        ~Stage() override
+        {
+            abort();
+            join();
+        }
+
+        void start() override
+        {
+            std::unique_lock lock{ _stateMutex };
+
+            _started = Time::NowSteady();
+            _running = _config.workers;
+
+            for (size_t i = 0; i < _config.workers; ++i)
+                _workers.emplace_back([this]() { work(); });
+        }
+
+        bool wait(Time timeout) override
+        {
+            std::unique_lock lock{ _stateMutex };
+
+            return _finished.wait_until(lock, deadlineAfter(timeout), [&]() { return _running == 0; });
+        }
+
+        void abort() override
+        {
+            // Channels first, a worker can hold the lock while it waits for room in the output
+            _input->close();
+            _output->close();
+
+            std::unique_lock lock{ _mutex };
+
+            _aborted = true;
+
+            lock.unlock();
+            _window.notify_all();
+        }
+
+        void join() override
+        {
+            for (auto& worker : _workers)
+            {
+                if (worker.joinable())
+                    worker.join();
+            }
+
+            _workers.clear();
+        }
+
+        StageStats stats() override
+        {
+            std::unique_lock lock{ _stateMutex };
+
+            auto stats = _stats;
+            if (_started != Time::Zero())
+                stats.elapsed = (_running == 0 ? _stopped : Time::NowSteady()) - _started;
+
+            return stats;
+        }
+    };
+
+    // Linear chain of stages connected by bounded channels, In goes in, Out comes out, in the same order.
+    // A full channel stops the stage feeding it, so a slow stage eventually blocks push() (end-to-end backpressure).
+    // In and all stage outputs have to be default constructible.
+    //
+    // Example:
+    //      auto pipeline = Pipeline<Packet>(8)
+    //          .then(StageConfig{}.withName("decode"), [](Packet&& packet) { return decode(packet); })
+    //          .then(StageConfig{}.withName("detect").withWorkers(4), [](Frame&& frame) { return detect(frame); })
+    //          .then(StageConfig{}.withName("encode"), [](Detections&& detections) { return encode(detections); });
+    //
+    //      pipeline.start();
+    //      pipeline.push(packet);
+    //      auto [status, encoded] = pipeline.recv();
+    //      pipeline.stop();
+    //
+    template<typename In, typename Out = In>
+    class Pipeline
+    {
+    protected:
+        template<typename, typename>
+        friend class Pipeline;
+
+        std::unique_ptr<detail::PipelineInput<In>> _input;
+        std::shared_ptr<detail::Pipe<Out>> _output;
+        std::vector<std::unique_ptr<detail::StageBase>> _stages;
+        bool _started = false;
+
+        Pipeline(std::unique_ptr<detail::PipelineInput<In>> input, std::shared_ptr<detail::Pipe<Out>> output, std::vector<std::unique_ptr<detail::StageBase>> stages)
+            : _input(std::move(input))
+            , _output(std::move(output))
+            , _stages(std::move(stages))
+        {
+        }
+
+    public:
+        // capacity of the input channel, push() blocks once it's full
+        explicit Pipeline(size_t capacity = 16ull)
+            requires std::is_same_v<In, Out>
+            : _input(std::make_unique<detail::PipelineInput<In>>())
+        {
+            _input->pipe = detail::openPipe<In>(capacity);
+            _output = _input->pipe;
+        }
+
+        Pipeline(Pipeline&&) = default;
+
+        // Nobody can receive the outputs anymore, so items in flight are dropped rather than waited for,
+        // call stop() first to let the stages finish them
+        ~Pipeline()
+        {
+            if (!_input)
+                return;
+
+            abort();
+
+            for (auto& stage : _stages)
+                stage->join();
+        }
+
+        // Appends a stage running function(Out&&), it returns the next item or std::optional of it (std::nullopt drops the item)
+        // With config.workers > 1 the function is called from several threads at once
+        template<typename F>
+        auto then(const StageConfig& config, F function) &&
+        {
+            using Result = std::invoke_result_t<F&, Out&&>;
+            using Next = typename detail::Unwrap<Result>::type;
+
+            auto output = detail::openPipe<Next>(config.capacity);
+
+            typename Stage<Out, Next>::Function wrapped = [function = std::move(function)](Out&& value) mutable -> std::optional<Next> {
+                return function(std::move(value));
+            };
+
+            _stages.push_back(std::make_unique<Stage<Out, Next>>(config, std::move(wrapped), _output, output));
+
+            return Pipeline<In, Next>(std::move(_input), std::move(output), std::move(_stages));
+        }
+
+        void start()
+        {
+            if (std::exchange(_started, true))
+                return;
+
+            for (auto& stage : _stages)
+                stage->start();
+        }
+
+        // Blocks while the input channel is full, returns false once the pipeline is stopped
+        bool push(In value)
+        {
+            std::unique_lock lock{ _input->mutex };
+
+            // Sequence numbers have to stay dense, a rejected item doesn't take one
+            if (!_input->pipe->q.add(detail::Envelope<In>{ _input->sequence, std::move(value), Time::NowSteady() }))
+                return false;
+
+            ++_input->sequence;
+
+            return true;
+        }
+
+        // Next output in input order, Shutdown once the pipeline has been drained and everything was received
+        std::pair<SyncQStatus, Out> recv(Time timeout)
+        {
+            auto [status, item] = _output->recv(timeout);
+
+            return { status, std::move(item.value) };
+        }
+
+        // Blocks until the next output or Shutdown
+        std::pair<SyncQStatus, Out> recv()
+        {
+            return recv(_output->q.consumerTimeout());
+        }
+
+        // Stops accepting input and waits up to timeout until all stages have processed what they got,
+        // the outputs stay available to recv(). If it times out (e.g. nobody receives the output), the pipeline is aborted.
+        bool stop(Time timeout = Time::FromSeconds(5))
+        {
+            detail::closePipe(*_input->pipe);
+
+            auto deadline = Time::NowSteady() + timeout;
+            bool drained = true;
+
+            for (auto& stage : _stages)
+            {
+                if (!stage->wait((std::max)(deadline - Time::NowSteady(), Time::Zero())))
+                {
+                    drained = false;
+                    break;
+                }
+            }
+
+            if (!drained)
+                abort();
+
+            for (auto& stage : _stages)
+                stage->join();
+
+            return drained;
+        }
+
+        // Stops right away, items in flight are dropped
+        void abort()
+        {
+            for (auto& stage : _stages)
+                stage->abort();
+        }
+
+        std::vector<StageStats> stats()
+        {
+            std::vector<StageStats> stats;
+
+            for (auto& stage : _stages)
+                stats.push_back(stage->stats());
+
+            return stats;
+        }
+    };
+}
@@ -0,0 +1,188 @@
+#include "mdsp_common/broadcast.h"
+#include "mdsp_common/wait_set.h"
+#include <thread>
+#include <vector>
+#include "check.h"
+
+using namespace mdsp;
+
+namespace
+{
+    std::vector<int> receiveAll(Broadcast<int>::Subscriber& subscriber)
+    {
+        std::vector<int> result;
+        Broadcast<int>::Payload payload;
+
+        while (subscriber.poll(payload))
+            result.push_back(*payload);
+
+        return result;
+    }
+
+    // Every subscriber reads the same payload instance, late subscribers only see later items
+    void fanOut()
+    {
+        Broadcast<int> numbers;
+
+        auto first = numbers.subscribe();
+        auto second = numbers.subscribe();
+
+        numbers.publish(1);
+        numbers.publish(2);
+
+        auto late = numbers.subscribe();
+
+        numbers.publish(3);
+
+        CHECK(numbers.subscribers() == 3 && numbers.published() == 3);
+        CHECK(first.size() == 3 && late.size() == 1);
+
+        auto [status1, payload1] = first.recv(Time::Zero());
+        auto [status2, payload2] = second.recv(Time::Zero());
+
+        CHECK(status1 == SyncQStatus::OK && status2 == SyncQStatus::OK);
+        CHECK(payload1 == payload2 && *payload1 == 1);
+
+        CHECK((receiveAll(first) == std::vector<int>{ 2, 3 }));
+        CHECK((receiveAll(second) == std::vector<int>{ 2, 3 }));
+        CHECK((receiveAll(late) == std::vector<int>{ 3 }));
+
+        late.unsubscribe();
+        CHECK(numbers.subscribers() == 2);
+    }
+
+    // Lag resumes from the oldest retained item, SkipToLatest from the newest one
+    void overwritingPolicies()
+    {
+        Broadcast<int> lagging(BroadcastConfig{}.withCapacity(4).withPolicy(SlowSubscriber::Lag));
+        auto slow = lagging.subscribe();
+        auto fast = lagging.subscribe();
+
+        for (int i = 0; i < 10; ++i)
+        {
+            CHECK(lagging.publish(i));
+            CHECK(receiveAll(fast).size() == 1);
+        }
+
+        CHECK(slow.size() == 10);
+        CHECK((receiveAll(slow) == std::vector<int>{ 6, 7, 8, 9 }));
+        CHECK(slow.missed() == 6 && fast.missed() == 0);
+
+        Broadcast<int> skipping(BroadcastConfig{}.withCapacity(4).withPolicy(SlowSubscriber::SkipToLatest));
+        auto skipper = skipping.subscribe();
+
+        for (int i = 0; i < 10; ++i)
+            skipping.publish(i);
+
+        CHECK((receiveAll(skipper) == std::vector<int>{ 9 }));
+        CHECK(skipper.missed() == 9);
+    }
+
+    // Block holds the publisher back until the slowest subscriber made room, or publishTimeout runs out
+    void blockingPolicy()
+    {
+        Broadcast<int> blocking(BroadcastConfig{}.withCapacity(2).withPolicy(SlowSubscriber::Block).withPublishTimeout(2_ms));
+        auto slow = blocking.subscribe();
+
+        CHECK(blocking.publish(0));
+        CHECK(blocking.publish(1));
+        CHECK(!blocking.publish(2));
+
+        auto read = SyncQStatus::Timeout;
+
+        std::thread reader([&]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            read = slow.recv(Time::Zero()).first;
+        });
+
+        Broadcast<int> waiting(BroadcastConfig{}.withCapacity(2).withPolicy(SlowSubscriber::Block).withPublishTimeout(1_s));
+        auto other = waiting.subscribe();
+
+        waiting.publish(0);
+        waiting.publish(1);
+
+        std::thread unsubscriber([&]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            other.unsubscribe();
+        });
+
+        // Slow subscriber leaving makes room too
+        CHECK(waiting.publish(2));
+
+        reader.join();
+        unsubscriber.join();
+
+        CHECK(read == SyncQStatus::OK);
+        CHECK(blocking.publish(3));
+        CHECK((receiveAll(slow) == std::vector<int>{ 1, 3 }));
+        CHECK(slow.missed() == 0);
+    }
+
+    // Subscribers read what was published before close, then get Shutdown, a blocked one wakes up
+    void closeDrains()
+    {
+        Broadcast<int> numbers;
+        auto subscriber = numbers.subscribe();
+        auto idle = numbers.subscribe();
+
+        numbers.publish(1);
+        CHECK(receiveAll(idle).size() == 1);
+
+        std::thread closer([&]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            numbers.close();
+        });
+
+        CHECK(idle.recv(Time::Max()).first == SyncQStatus::Shutdown);
+        closer.join();
+
+        CHECK(!numbers.publish(2));
+        CHECK(!subscriber.shouldReceive());
+        CHECK((receiveAll(subscriber) == std::vector<int>{ 1 }));
+        CHECK(subscriber.recv(Time::Zero()).first == SyncQStatus::Shutdown);
+    }
+
+    // A subscriber in a WaitSet next to a queue
+    void inWaitSet()
+    {
+        Broadcast<int> numbers;
+        auto subscriber = numbers.subscribe();
+
+        SyncQueue<int> commands;
+        commands.shouldReceive(true);
+
+        WaitSet<Broadcast<int>::Subscriber, SyncQueue<int>> waitSet(SelectOrder::Priority, subscriber, commands);
+
+        std::thread publisher([&]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            numbers.publish(42);
+        });
+
+        int received = 0;
+        auto status = waitSet.select(1_s, [&](Broadcast<int>::Payload&& payload) { received = *payload; }, [](int) {});
+
+        publisher.join();
+
+        CHECK(status == SyncQStatus::OK && received == 42);
+
+        numbers.close();
+        commands.shouldReceive(false);
+
+        CHECK(waitSet.select(Time::Zero(), [](Broadcast<int>::Payload&&) {}, [](int) {}) == SyncQStatus::Shutdown);
+    }
+}
+
+int main()
+{
+    fanOut();
+    overwritingPolicies();
+    blockingPolicy();
+    closeDrains();
+    inWaitSet();
+
+    return check::result();
+}
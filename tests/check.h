@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdio>
+
+// Minimal assertion helpers, a test executable returns the number of failed checks
+namespace check
+{
+    inline int failures = 0;
+
+    inline int result()
+    {
+        if (failures == 0)
+            std::printf("OK\n");
+
+        return failures;
+    }
+}
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++check::failures; \
+        } \
+    } while (false)
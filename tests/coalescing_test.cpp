@@ -0,0 +1,97 @@
+#include "mdsp_common/channel.h"
+#include "check.h"
+
+using namespace mdsp;
+
+namespace
+{
+    struct A { int value; };
+    struct B { int value; };
+
+    using Messages = std::variant<A, B>;
+
+    template<typename Backend>
+    void updateCoalesces()
+    {
+        Channel<Messages, Backend> ch;
+        ch.open(ChannelConfig{}.withCapacity(100));
+
+        ch.update(A{ 1 });
+        ch.send(B{ 1 });
+        ch.update(A{ 2 });
+
+        CHECK(ch.template count<A>() == 1);
+        CHECK(ch.template count<B>() == 1);
+
+        int value = 0;
+        ch.template select<A>([&](A& a) { value = a.value; });
+        CHECK(value == 2);
+    }
+
+    // Front insertion into an empty queue must not lose the index entry
+    template<typename Backend>
+    void frontUpdateCoalesces()
+    {
+        Channel<Messages, Backend> ch;
+        ch.open(ChannelConfig{}.withCapacity(100));
+
+        ch.template update<dispatch::Priority>(A{ 1 });
+        ch.template update<dispatch::Priority>(A{ 2 });
+
+        CHECK(ch.template count<A>() == 1);
+
+        ch.template send<dispatch::Priority>(B{ 1 });
+        ch.template update<dispatch::Priority>(A{ 3 });
+        ch.template update<dispatch::Priority>(B{ 2 });
+
+        CHECK(ch.template count<A>() == 1);
+        CHECK(ch.template count<B>() == 1);
+
+        auto [status, front] = ch.recv(Time::Zero());
+        CHECK(status == SyncQStatus::OK);
+        CHECK(std::holds_alternative<B>(front) && std::get<B>(front).value == 2);
+
+        auto [status2, back] = ch.recv(Time::Zero());
+        CHECK(status2 == SyncQStatus::OK);
+        CHECK(std::holds_alternative<A>(back) && std::get<A>(back).value == 3);
+
+        // Cleared and refilled from the front again
+        ch.send(A{ 4 });
+        ch.clear();
+        ch.template update<dispatch::Priority>(A{ 5 });
+        ch.template update<dispatch::Priority>(A{ 6 });
+
+        CHECK(ch.template count<A>() == 1);
+    }
+
+    template<typename Backend>
+    void frontBulkUpdateCoalesces()
+    {
+        Channel<Messages, Backend> ch;
+        ch.open(ChannelConfig{}.withCapacity(100));
+
+        std::vector<Messages> batch{ A{ 1 }, B{ 1 } };
+        ch.template sendBatch<dispatch::Priority>(batch);
+        ch.update(A{ 2 });
+        ch.update(B{ 2 });
+
+        CHECK(ch.template count<A>() == 1);
+        CHECK(ch.template count<B>() == 1);
+    }
+}
+
+int main()
+{
+    updateCoalesces<backend::Coalescing<>>();
+    updateCoalesces<backend::Coalescing<backend::Ring>>();
+    updateCoalesces<backend::Mutex>();
+
+    frontUpdateCoalesces<backend::Coalescing<>>();
+    frontUpdateCoalesces<backend::Coalescing<backend::Ring>>();
+    frontUpdateCoalesces<backend::Mutex>();
+
+    frontBulkUpdateCoalesces<backend::Coalescing<>>();
+    frontBulkUpdateCoalesces<backend::Coalescing<backend::Ring>>();
+
+    return check::result();
+}
@@ -0,0 +1,144 @@
+#include "mdsp_common/wrapper.h"
+#include "executor.h"
+#include <chrono>
+#include <functional>
+#include <vector>
+#include "check.h"
+
+using namespace cisim;
+
+namespace
+{
+    struct Hit {};
+    struct Ping : Awaitable {};
+    struct Nap { int ms; };
+
+    // Starts the coroutine on the actor's worker
+    struct Relay { std::function<void()> start; };
+
+    using Commands = std::variant<Hit, Ping, Relay, Nap>;
+
+    struct CounterState {};
+
+    class Counter
+        : public Actor<CounterState, Commands>
+    {
+    public:
+        std::atomic<int> hits = 0;
+
+        void execute(CounterState&, Hit&)
+        {
+            ++hits;
+        }
+
+        void execute(CounterState&, Ping&)
+        {
+        }
+
+        void execute(CounterState&, Relay& relay)
+        {
+            relay.start();
+        }
+
+        void execute(CounterState&, Nap& nap)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(nap.ms));
+        }
+    };
+
+    bool waitFor(std::atomic<int>& value, int expected)
+    {
+        auto deadline = Time::NowSteady() + Time::FromSeconds(1);
+
+        while (value < expected && Time::NowSteady() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        return value == expected;
+    }
+
+    // Commands sent before start() or after stop() don't schedule the mailbox, start() opens the channel
+    // and schedules it again
+    void sendOutsideOfStart()
+    {
+        Executor executor(2);
+        Counter counter;
+
+        counter.async(Hit{});
+
+        counter.start(executor, {}, ThreadConfig{});
+        counter.async(Hit{});
+        CHECK(waitFor(counter.hits, 1));
+
+        counter.stop();
+        counter.async(Hit{});
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        CHECK(counter.hits == 1);
+
+        counter.start(executor, {}, ThreadConfig{});
+        counter.async(Hit{});
+        CHECK(waitFor(counter.hits, 2));
+
+        counter.stop();
+    }
+
+    Task ping(Executor& executor, Counter& target, std::atomic<int>& resumed)
+    {
+        auto result = co_await target.async<Ping>();
+
+        if (result == Awaitable::OK && Executor::current() == &executor)
+            ++resumed;
+    }
+
+    // The coroutine is resumed on the executor it suspended on, not inside notify() on the target's worker
+    void coroutineResumesOnExecutor()
+    {
+        Executor executor(2);
+        Counter source;
+        Counter target;
+
+        source.start(executor, {}, ThreadConfig{});
+        target.start(executor, {}, ThreadConfig{});
+
+        std::atomic<int> resumed = 0;
+
+        source.async(Relay{ [&]() { ping(executor, target, resumed); } });
+
+        CHECK(waitFor(resumed, 1));
+
+        source.stop();
+        target.stop();
+    }
+
+    // Commands still queued when the actor stops are dropped, their callers get Shutdown instead of waiting forever
+    void stopUnblocksQueued()
+    {
+        Executor executor(1);
+        Counter counter;
+
+        counter.start(executor, {}, ThreadConfig(ChannelConfig{}.withCapacity(100)));
+        counter.async(Nap{ 50 });
+
+        std::vector<Awaitable> queued;
+
+        for (int i = 0; i < 5; ++i)
+            queued.push_back(counter.async<Ping>());
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        counter.stop();
+
+        for (auto& awaitable : queued)
+            CHECK(awaitable.wait(Time::FromMilliseconds(100)) == Awaitable::Shutdown);
+
+        auto late = counter.async<Ping>();
+        CHECK(late.wait(Time::FromMilliseconds(100)) == Awaitable::Shutdown);
+    }
+}
+
+int main()
+{
+    sendOutsideOfStart();
+    coroutineResumesOnExecutor();
+    stopUnblocksQueued();
+
+    return check::result();
+}
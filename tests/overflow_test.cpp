@@ -0,0 +1,158 @@
+#include "mdsp_common/channel.h"
+#include <thread>
+#include <vector>
+#include "check.h"
+
+using namespace mdsp;
+
+namespace
+{
+    struct Data { int value; };
+
+    using Messages = std::variant<Data>;
+
+    template<typename Backend>
+    std::vector<int> receiveAll(Channel<Messages, Backend>& ch)
+    {
+        std::vector<int> values;
+
+        while (true)
+        {
+            auto [status, msg] = ch.recv(Time::Zero());
+
+            if (status != SyncQStatus::OK)
+                return values;
+
+            values.push_back(std::get<Data>(msg).value);
+        }
+    }
+
+    template<typename Backend>
+    void reject()
+    {
+        Channel<Messages, Backend> ch;
+        ch.open(ChannelConfig{}.withCapacity(2).withOverflow(Overflow::Reject));
+
+        for (int i = 0; i < 4; ++i)
+            ch.send(Data{ i });
+
+        CHECK(ch.overflowCounters().rejected == 2);
+        CHECK((receiveAll(ch) == std::vector<int>{ 0, 1 }));
+    }
+
+    template<typename Backend>
+    void dropNewest()
+    {
+        Channel<Messages, Backend> ch;
+        ch.open(ChannelConfig{}.withCapacity(2).withOverflow(Overflow::DropNewest));
+
+        for (int i = 0; i < 4; ++i)
+            ch.send(Data{ i });
+
+        CHECK(ch.overflowCounters().droppedNewest == 2);
+        CHECK((receiveAll(ch) == std::vector<int>{ 0, 1 }));
+    }
+
+    template<typename Backend>
+    void dropOldest()
+    {
+        Channel<Messages, Backend> ch;
+        ch.open(ChannelConfig{}.withCapacity(2).withOverflow(Overflow::DropOldest));
+
+        for (int i = 0; i < 4; ++i)
+            ch.send(Data{ i });
+
+        CHECK(ch.overflowCounters().droppedOldest == 2);
+        CHECK((receiveAll(ch) == std::vector<int>{ 2, 3 }));
+    }
+
+    // Concurrent producers never push the queue over its capacity
+    template<typename Backend>
+    void capacityIsHard()
+    {
+        constexpr size_t capacity = 4;
+
+        Channel<Messages, Backend> ch;
+        ch.open(ChannelConfig{}.withCapacity(capacity).withOverflow(Overflow::Reject));
+
+        std::vector<std::thread> producers;
+
+        for (int p = 0; p < 8; ++p)
+        {
+            producers.emplace_back([&]() {
+                for (int i = 0; i < 10000; ++i)
+                    ch.send(Data{ i });
+            });
+        }
+
+        size_t maxSize = 0;
+
+        for (int i = 0; i < 20000; ++i)
+            maxSize = std::max(maxSize, ch.q.size());
+
+        for (auto& producer : producers)
+            producer.join();
+
+        CHECK(maxSize <= capacity);
+        CHECK(receiveAll(ch).size() <= capacity);
+    }
+
+    struct Control { int value; };
+
+    using LaneMessages = std::variant<Data, Control>;
+
+    // Lanes evict the oldest data, never the urgent control commands in lane 0
+    void dropOldestKeepsUrgent()
+    {
+        Channel<LaneMessages, backend::Lanes<2>> ch;
+        ch.open(ChannelConfig{}.withCapacity(2).withOverflow(Overflow::DropOldest));
+
+        ch.send<dispatch::Priority>(Control{ 1 });
+        ch.send(Data{ 1 });
+        ch.send(Data{ 2 });
+
+        CHECK(ch.overflowCounters().droppedOldest == 1);
+        CHECK(ch.count<Control>() == 1);
+        CHECK(ch.count<Data>() == 1);
+
+        auto [first, control] = ch.recv(Time::Zero());
+        CHECK(first == SyncQStatus::OK && std::holds_alternative<Control>(control));
+
+        auto [second, data] = ch.recv(Time::Zero());
+        CHECK(second == SyncQStatus::OK && std::holds_alternative<Data>(data) && std::get<Data>(data).value == 2);
+
+        // Only urgent items queued, the oldest of them is evicted
+        ch.send<dispatch::Priority>(Control{ 2 });
+        ch.send<dispatch::Priority>(Control{ 3 });
+        ch.send<dispatch::Priority>(Control{ 4 });
+
+        auto [third, oldest] = ch.recv(Time::Zero());
+        CHECK(third == SyncQStatus::OK && std::get<Control>(oldest).value == 3);
+    }
+
+    template<typename Backend>
+    void run()
+    {
+        reject<Backend>();
+        dropNewest<Backend>();
+        dropOldest<Backend>();
+        capacityIsHard<Backend>();
+    }
+}
+
+int main()
+{
+    run<backend::Mutex>();
+    run<backend::Ring>();
+    run<backend::MPMC>();
+    run<backend::Sharded<>>();
+    run<backend::Lanes<2>>();
+
+    dropOldestKeepsUrgent();
+
+    // ReaderWriterQueue producers can't dequeue, DropOldest drops the new item instead
+    reject<backend::SPSC>();
+    dropNewest<backend::SPSC>();
+
+    return check::result();
+}
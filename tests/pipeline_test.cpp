@@ -0,0 +1,80 @@
+#include "mdsp_common/wrapper.h"
+#include "pipeline.h"
+#include <chrono>
+#include "check.h"
+
+using namespace cisim;
+
+namespace
+{
+    Pipeline<int> doubling(size_t workers)
+    {
+        return Pipeline<int>(4)
+            .then(StageConfig{}.withWorkers(workers).withCapacity(4), [](int&& value) { return value * 2; });
+    }
+
+    // Outputs keep the input order, recv() blocks until they arrive
+    void keepsOrder()
+    {
+        auto pipeline = doubling(4);
+        pipeline.start();
+
+        std::thread producer([&]() {
+            for (int i = 0; i < 100; ++i)
+                CHECK(pipeline.push(i));
+        });
+
+        for (int i = 0; i < 100; ++i)
+        {
+            auto [status, value] = pipeline.recv();
+
+            CHECK(status == SyncQStatus::OK && value == i * 2);
+        }
+
+        producer.join();
+
+        CHECK(pipeline.stop());
+
+        auto [status, value] = pipeline.recv();
+        CHECK(status == SyncQStatus::Shutdown);
+    }
+
+    // Items pushed after stop() are rejected and don't leave a gap in the stream
+    void pushAfterStop()
+    {
+        auto pipeline = doubling(1);
+        pipeline.start();
+
+        CHECK(pipeline.push(1));
+        CHECK(pipeline.stop());
+        CHECK(!pipeline.push(2));
+
+        auto [status, value] = pipeline.recv();
+        CHECK(status == SyncQStatus::OK && value == 2);
+    }
+
+    // Outputs nobody receives don't keep the destructor waiting
+    void destroyWithPendingOutput()
+    {
+        auto start = Time::NowSteady();
+
+        {
+            auto pipeline = doubling(1);
+            pipeline.start();
+
+            for (int i = 0; i < 8; ++i)
+                pipeline.push(i);
+        }
+
+        CHECK(Time::NowSteady() - start < Time::FromSeconds(1));
+    }
+}
+
+int main()
+{
+    keepsOrder();
+    pushAfterStop();
+    destroyWithPendingOutput();
+
+    return check::result();
+}
@@ -0,0 +1,154 @@
+#include "mdsp_common/channel.h"
+#include <vector>
+#include "check.h"
+
+using namespace mdsp;
+
+namespace
+{
+    template<typename Storage>
+    std::vector<int> drain(Storage& lanes)
+    {
+        std::vector<int> result;
+
+        while (!lanes.empty())
+        {
+            result.push_back(lanes.front());
+            lanes.pop_front();
+        }
+
+        return result;
+    }
+
+    // The highest non-empty lane is served first, each lane keeps FIFO order
+    void highestLaneFirst()
+    {
+        PriorityLanes<int, 3> lanes;
+
+        lanes.push(2, 20);
+        lanes.push(1, 10);
+        lanes.push(2, 21);
+        lanes.push_back(22);
+        lanes.push_front(0);
+        lanes.push(1, 11);
+        lanes.push_front(1);
+
+        CHECK(lanes.size() == 7);
+        CHECK(lanes.size(0) == 2 && lanes.size(1) == 2 && lanes.size(2) == 3);
+        CHECK(lanes.back() == 22 && lanes.lowest_front() == 20);
+
+        std::vector<int> iterated(lanes.begin(), lanes.end());
+        CHECK((iterated == std::vector<int>{ 0, 1, 10, 11, 20, 21, 22 }));
+
+        CHECK((drain(lanes) == std::vector<int>{ 0, 1, 10, 11, 20, 21, 22 }));
+    }
+
+    // With Aging = 2, every third item comes from a lower lane, round-robin over the lower lanes
+    void agingServesLowerLanes()
+    {
+        PriorityLanes<int, 3, 2> lanes;
+
+        for (int i = 0; i < 6; ++i)
+            lanes.push(0, i);
+
+        lanes.push(1, 10);
+        lanes.push(1, 11);
+        lanes.push(2, 20);
+
+        CHECK((drain(lanes) == std::vector<int>{ 0, 1, 10, 2, 3, 20, 4, 5, 11 }));
+    }
+
+    void eraseAndInsert()
+    {
+        PriorityLanes<int, 2> lanes;
+
+        lanes.push(1, 1);
+        lanes.push(1, 2);
+        lanes.push(0, 3);
+
+        CHECK(lanes.erase_if([](int v) { return v % 2 == 1; }) == 2);
+        CHECK(lanes.size() == 1 && lanes.size(0) == 0);
+
+        std::vector<int> urgent{ 7, 8 };
+        lanes.insert(lanes.begin(), urgent.begin(), urgent.end());
+
+        CHECK((drain(lanes) == std::vector<int>{ 7, 8, 2 }));
+    }
+
+    struct Data { int value; };
+    struct Control { int value; };
+
+    using Messages = std::variant<Data, Control>;
+
+    int valueOf(const Messages& msg)
+    {
+        return std::visit([](auto& m) { return m.value; }, msg);
+    }
+
+    std::vector<int> receiveAll(auto& ch)
+    {
+        std::vector<int> result;
+
+        while (true)
+        {
+            auto [status, msg] = ch.recv(Time::Zero());
+
+            if (status != SyncQStatus::OK)
+                break;
+
+            result.push_back(valueOf(msg));
+        }
+
+        return result;
+    }
+
+    // backend::Lanes through the Channel API: Priority, Serial and Lane<I> dispatch
+    void lanesChannel()
+    {
+        Channel<Messages, backend::Lanes<3>> ch;
+        ch.open(ChannelConfig{});
+
+        ch.send(Data{ 20 });
+        ch.send<dispatch::Lane<1>>(Data{ 10 });
+        ch.send<dispatch::Priority>(Control{ 0 });
+        ch.send(Data{ 21 });
+        ch.send<dispatch::Lane<1>>(Control{ 11 });
+        ch.send<dispatch::Priority>(Control{ 1 });
+
+        CHECK((receiveAll(ch) == std::vector<int>{ 0, 1, 10, 11, 20, 21 }));
+    }
+
+    // Overflow::DropOldest evicts from the lowest lane, urgent messages survive a full queue
+    void dropOldestLowestLane()
+    {
+        Channel<Messages, backend::Lanes<2>> ch;
+        ch.open(ChannelConfig{}.withCapacity(3).withOverflow(Overflow::DropOldest));
+
+        ch.send<dispatch::Priority>(Control{ 0 });
+        ch.send(Data{ 10 });
+        ch.send(Data{ 11 });
+        ch.send<dispatch::Priority>(Control{ 1 });
+        ch.send<dispatch::Priority>(Control{ 2 });
+
+        CHECK(ch.overflowCounters().droppedOldest == 2);
+        CHECK((receiveAll(ch) == std::vector<int>{ 0, 1, 2 }));
+
+        ch.send(Data{ 12 });
+        ch.send(Data{ 13 });
+        ch.send(Data{ 14 });
+        ch.send(Data{ 15 });
+
+        CHECK((receiveAll(ch) == std::vector<int>{ 13, 14, 15 }));
+    }
+}
+
+int main()
+{
+    highestLaneFirst();
+    agingServesLowerLanes();
+    eraseAndInsert();
+    lanesChannel();
+    dropOldestLowestLane();
+
+    return check::result();
+}
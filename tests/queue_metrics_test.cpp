@@ -0,0 +1,151 @@
+#include "mdsp_common/channel.h"
+#include <thread>
+#include <vector>
+#include "check.h"
+
+using namespace mdsp;
+
+namespace
+{
+    struct Data { int value; };
+    struct Control { int value; };
+
+    using Messages = std::variant<Data, Control>;
+
+    template<typename Ch>
+    size_t receiveAll(Ch& ch)
+    {
+        size_t received = 0;
+
+        while (ch.recv(Time::Zero()).first == SyncQStatus::OK)
+            ++received;
+
+        return received;
+    }
+
+    // Each enqueued item records the depth it found, bucket i holds [2^(i-1), 2^i)
+    void depthHistogram()
+    {
+        Channel<Messages, backend::Instrumented<>> ch;
+        ch.open(ChannelConfig{}.withCapacity(16));
+
+        for (int i = 0; i < 5; ++i)
+            ch.send(Data{ i });
+
+        auto metrics = ch.metrics();
+
+        CHECK(metrics.enqueued == 5 && metrics.dequeued == 0);
+        CHECK(metrics.maxDepth == 4);
+        CHECK(metrics.depth[0] == 1 && metrics.depth[1] == 1 && metrics.depth[2] == 2 && metrics.depth[3] == 1);
+        CHECK(QueueMetricsSnapshot::percentile(metrics.depth, 0.5) == 1);
+        CHECK(QueueMetricsSnapshot::percentile(metrics.depth, 1.0) == 7);
+    }
+
+    // Enqueue to dequeue time of every received item
+    void latency()
+    {
+        Channel<Messages, backend::Instrumented<backend::Ring>> ch;
+        ch.open(ChannelConfig{}.withCapacity(4));
+
+        ch.send(Data{ 1 });
+        ch.send(Data{ 2 });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+        CHECK(receiveAll(ch) == 2);
+
+        auto metrics = ch.metrics();
+        uint64_t counted = 0;
+
+        for (size_t i = 0; i < QueueMetricsSnapshot::Buckets; ++i)
+        {
+            counted += metrics.latency[i];
+
+            // 2 ms is 2000 us, bucket 11 and above
+            if (i < 11)
+                CHECK(metrics.latency[i] == 0);
+        }
+
+        CHECK(metrics.dequeued == 2 && counted == 2);
+        CHECK(metrics.maxLatency >= 2_ms && metrics.meanLatency() >= 2_ms);
+        CHECK(metrics.totalLatency >= metrics.maxLatency);
+    }
+
+    // Drops keep the enqueue timestamps in line with the queued items
+    void overflowPolicies()
+    {
+        Channel<Messages, backend::Instrumented<>> ch;
+        ch.open(ChannelConfig{}.withCapacity(2).withOverflow(Overflow::DropOldest));
+
+        for (int i = 0; i < 5; ++i)
+            ch.send(Data{ i });
+
+        CHECK(ch.metrics().dropped == 3);
+
+        auto [status, msg] = ch.recv(Time::Zero());
+        CHECK(status == SyncQStatus::OK && std::get<Data>(msg).value == 3);
+        CHECK(receiveAll(ch) == 1);
+        CHECK(ch.metrics().dequeued == 2);
+
+        Channel<Messages, backend::Instrumented<>> newest;
+        newest.open(ChannelConfig{}.withCapacity(1).withOverflow(Overflow::DropNewest));
+
+        newest.send(Data{ 0 });
+        newest.send(Data{ 1 });
+
+        auto metrics = newest.metrics();
+        CHECK(metrics.enqueued == 1 && metrics.dropped == 1 && metrics.rejected == 0);
+    }
+
+    // Producer blocked on a full queue until producerTimeout, consumer running out of its timeout
+    void timeouts()
+    {
+        Channel<Messages, backend::Instrumented<>> ch;
+        ch.open(ChannelConfig{}.withCapacity(1).withSendTimeout(2_ms));
+
+        ch.send(Data{ 0 });
+        ch.send(Data{ 1 });
+
+        auto metrics = ch.metrics();
+        CHECK(metrics.blocked == 1 && metrics.producerTimeouts == 1 && metrics.rejected == 1);
+        CHECK(metrics.blockedTime >= 2_ms && metrics.maxBlockedTime == metrics.blockedTime);
+
+        CHECK(receiveAll(ch) == 1);
+        CHECK(ch.recv(1_ms).first == SyncQStatus::Timeout);
+        CHECK(ch.metrics().consumerTimeouts == 2);
+
+        ch.close();
+        ch.send(Data{ 2 });
+        CHECK(ch.metrics().rejected == 2);
+    }
+
+    // Front insertion and lanes: every item is counted once, whichever order it's dequeued in
+    void priorityStorages()
+    {
+        Channel<Messages, backend::Instrumented<backend::Lanes<2>>> ch;
+        ch.open(ChannelConfig{}.withCapacity(8));
+
+        ch.send(Data{ 0 });
+        ch.send<dispatch::Priority>(Control{ 1 });
+        ch.send<dispatch::Lane<1>>(Data{ 2 });
+
+        std::vector<Messages> urgent{ Control{ 3 }, Control{ 4 } };
+        ch.sendBatch<dispatch::Priority>(urgent);
+
+        CHECK(receiveAll(ch) == 5);
+
+        auto metrics = ch.metrics();
+        CHECK(metrics.enqueued == 5 && metrics.dequeued == 5);
+    }
+}
+
+int main()
+{
+    depthHistogram();
+    latency();
+    overflowPolicies();
+    timeouts();
+    priorityStorages();
+
+    return check::result();
+}
@@ -0,0 +1,162 @@
+#include "mdsp_common/channel.h"
+#include <vector>
+#include "check.h"
+
+using namespace mdsp;
+
+namespace
+{
+    // Counts live instances, so that leaks and double destruction show up
+    struct Tracked
+    {
+        static inline int live = 0;
+
+        int value = 0;
+
+        Tracked(int value = 0) : value(value) { ++live; }
+        Tracked(const Tracked& other) : value(other.value) { ++live; }
+        Tracked(Tracked&& other) noexcept : value(other.value) { ++live; }
+        Tracked& operator=(const Tracked&) = default;
+        Tracked& operator=(Tracked&&) noexcept = default;
+        ~Tracked() { --live; }
+    };
+
+    std::vector<int> values(const RingBuffer<Tracked>& ring)
+    {
+        std::vector<int> result;
+
+        for (auto& item : ring)
+            result.push_back(item.value);
+
+        return result;
+    }
+
+    // Items keep their order while the head wraps around, without reallocating
+    void wrapsAround()
+    {
+        RingBuffer<Tracked> ring(4);
+
+        for (int round = 0; round < 10; ++round)
+        {
+            ring.push_back(round);
+            ring.push_back(round + 1);
+            ring.push_back(round + 2);
+
+            CHECK(ring.front().value == round && ring.back().value == round + 2);
+
+            ring.pop_front();
+            ring.pop_front();
+            ring.pop_front();
+        }
+
+        CHECK(ring.capacity() == 4);
+        CHECK(ring.empty());
+        CHECK(Tracked::live == 0);
+    }
+
+    void frontInsertion()
+    {
+        RingBuffer<Tracked> ring(8);
+
+        ring.push_back(3);
+        ring.push_front(2);
+        ring.push_back(4);
+
+        std::vector<Tracked> batch{ 0, 1 };
+        ring.insert(ring.begin(), batch.begin(), batch.end());
+
+        CHECK((values(ring) == std::vector<int>{ 0, 1, 2, 3, 4 }));
+
+        ring.insert(ring.begin() + 2, batch.begin(), batch.end());
+        CHECK((values(ring) == std::vector<int>{ 0, 1, 0, 1, 2, 3, 4 }));
+
+        ring.erase(ring.begin() + 1, ring.begin() + 3);
+        CHECK((values(ring) == std::vector<int>{ 0, 1, 2, 3, 4 }));
+
+        batch.clear();
+        ring.clear();
+        CHECK(Tracked::live == 0);
+    }
+
+    // A full ring grows (unbounded queues), reserve never drops items
+    void growsAndShrinks()
+    {
+        RingBuffer<Tracked> ring(2);
+
+        for (int i = 0; i < 5; ++i)
+            ring.push_front(i);
+
+        CHECK(ring.capacity() >= 5);
+        CHECK((values(ring) == std::vector<int>{ 4, 3, 2, 1, 0 }));
+
+        ring.reserve(1);
+        CHECK(ring.capacity() == 5);
+
+        ring.pop_back();
+        ring.pop_back();
+        ring.reserve(3);
+        CHECK(ring.capacity() == 3 && ring.full());
+        CHECK((values(ring) == std::vector<int>{ 4, 3, 2 }));
+
+        auto copy = ring;
+        CHECK(values(copy) == values(ring));
+
+        ring.clear();
+        copy.clear();
+        CHECK(Tracked::live == 0);
+    }
+
+    struct Data { int value; };
+    struct Control { int value; };
+
+    using Messages = std::variant<Data, Control>;
+
+    // backend::Ring through the Channel API: front insertion, remove<>, count<> and resizing
+    void ringChannel()
+    {
+        Channel<Messages, backend::Ring> ch;
+        ch.open(ChannelConfig{}.withCapacity(4));
+
+        ch.send(Data{ 1 });
+        ch.send(Control{ 2 });
+        ch.send(Data{ 3 });
+        ch.send<dispatch::Priority>(Control{ 0 });
+
+        CHECK(ch.isFull());
+        CHECK(ch.count<Control>() == 2);
+
+        ch.remove<Control>();
+        CHECK(ch.count<Control>() == 0 && ch.count<Data>() == 2);
+
+        ch.q.capacity(8);
+
+        for (int i = 4; i < 10; ++i)
+            ch.send(Data{ i });
+
+        CHECK(ch.isFull());
+
+        std::vector<int> received;
+
+        while (true)
+        {
+            auto [status, msg] = ch.recv(Time::Zero());
+
+            if (status != SyncQStatus::OK)
+                break;
+
+            received.push_back(std::get<Data>(msg).value);
+        }
+
+        CHECK((received == std::vector<int>{ 1, 3, 4, 5, 6, 7, 8, 9 }));
+    }
+}
+
+int main()
+{
+    wrapsAround();
+    frontInsertion();
+    growsAndShrinks();
+    ringChannel();
+
+    return check::result();
+}
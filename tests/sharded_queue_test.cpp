@@ -0,0 +1,194 @@
+#include "mdsp_common/channel.h"
+#include <thread>
+#include <vector>
+#include <iterator>
+#include "check.h"
+
+using namespace mdsp;
+
+namespace
+{
+    struct Item
+    {
+        int producer = 0;
+        int seq = 0;
+    };
+
+    using Messages = std::variant<Item>;
+
+    // Many producers through a small capacity, every producer's items arrive complete and in order
+    void perProducerOrder()
+    {
+        constexpr int Producers = 12;
+        constexpr int PerProducer = 5000;
+
+        Channel<Messages, backend::Sharded<4>> ch;
+        ch.open(ChannelConfig{}.withCapacity(64));
+
+        std::vector<std::thread> producers;
+
+        for (int p = 0; p < Producers; ++p)
+        {
+            producers.emplace_back([&ch, p]()
+            {
+                for (int i = 0; i < PerProducer; ++i)
+                    ch.send(Item{ p, i });
+            });
+        }
+
+        std::vector<int> next(Producers, 0);
+        std::vector<Messages> batch(32);
+        int received = 0;
+        bool ordered = true;
+
+        while (received < Producers * PerProducer)
+        {
+            auto [status, count] = ch.recvBatch(batch.begin(), batch.size(), 1_s);
+
+            if (status != SyncQStatus::OK)
+                break;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto& item = std::get<Item>(batch[i]);
+
+                ordered = ordered && item.seq == next[item.producer];
+                next[item.producer] = item.seq + 1;
+            }
+
+            received += int(count);
+        }
+
+        for (auto& producer : producers)
+            producer.join();
+
+        CHECK(ordered);
+        CHECK(received == Producers * PerProducer);
+        CHECK(ch.empty());
+    }
+
+    // Two producer threads get distinct shards, the consumer takes one item per shard in turn.
+    // The value type is used by this test only, so the shard numbering starts from 0 here.
+    void roundRobin()
+    {
+        ShardedQueue<long, 2> q(0);
+
+        auto fill = [&]()
+        {
+            for (long base : { 0, 10 })
+            {
+                std::thread([&q, base]()
+                {
+                    for (long i = 1; i <= 3; ++i)
+                        q.add(base + i);
+                }).join();
+            }
+        };
+
+        fill();
+
+        std::vector<long> received;
+        long item = 0;
+
+        while (q.poll(item))
+            received.push_back(item);
+
+        CHECK((received == std::vector<long>{ 1, 11, 2, 12, 3, 13 }));
+
+        // After a batch the next receive continues after the last shard the batch took an item from
+        fill();
+        received.clear();
+
+        auto [status, count] = q.getBulk(std::back_inserter(received), 3, Time::Zero());
+        CHECK(status == SyncQStatus::OK && count == 3);
+
+        while (q.poll(item))
+            received.push_back(item);
+
+        CHECK((received == std::vector<long>{ 1, 11, 2, 12, 3, 13 }));
+    }
+
+    void overflowPolicies()
+    {
+        ShardedQueue<int, 4> reject(2);
+        reject.overflow(Overflow::Reject);
+
+        CHECK(reject.add(1) && reject.add(2));
+        CHECK(!reject.add(3));
+        CHECK(reject.overflowCounters().rejected == 1 && reject.size() == 2);
+
+        ShardedQueue<int, 4> oldest(2);
+        oldest.overflow(Overflow::DropOldest);
+
+        for (int i = 1; i <= 5; ++i)
+            CHECK(oldest.add(i));
+
+        int item = 0;
+        CHECK(oldest.poll(item) && item == 4);
+        CHECK(oldest.poll(item) && item == 5);
+        CHECK(oldest.overflowCounters().droppedOldest == 3);
+
+        ShardedQueue<int, 4> newest(1);
+        newest.overflow(Overflow::DropNewest);
+
+        CHECK(newest.add(1) && newest.add(2));
+        CHECK(newest.overflowCounters().droppedNewest == 1 && newest.size() == 1);
+
+        // Block gives up after producerTimeout, in bulk the items that didn't fit are counted as rejected
+        ShardedQueue<int, 4> blocking(4);
+        blocking.producerTimeout(2_ms);
+
+        std::vector<int> items{ 1, 2, 3, 4, 5, 6 };
+        CHECK(blocking.addBulk(items.begin(), items.end()) == 4);
+        CHECK(!blocking.add(7));
+        CHECK(blocking.overflowCounters().rejected == 3);
+        CHECK(blocking.isFull());
+    }
+
+    // Closing wakes up blocked producers and consumers, queued items can still be drained without clearing
+    void closeWakesWaiters()
+    {
+        ShardedQueue<int, 4> q(1);
+        q.producerTimeout(10_s);
+
+        CHECK(q.add(1));
+
+        bool accepted = true;
+        std::thread producer([&]() { accepted = q.add(2); });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        q.shouldReceive(false, ClearCache(false));
+        producer.join();
+
+        CHECK(!accepted);
+        CHECK(!q.add(3));
+
+        auto [status, item] = q.getWithStatus(Time::Zero());
+        CHECK(status == SyncQStatus::OK && item == 1);
+        CHECK(q.getWithStatus(Time::Zero()).first == SyncQStatus::Shutdown);
+
+        // The slot of the refused producer was released, the queue is usable again at full capacity
+        q.shouldReceive(true);
+        CHECK(q.size() == 0 && q.add(4));
+        CHECK(q.poll(item) && item == 4);
+
+        auto waiting = SyncQStatus::OK;
+        std::thread consumer([&]() { waiting = q.getWithStatus(10_s).first; });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        q.shouldReceive(false);
+        consumer.join();
+
+        CHECK(waiting == SyncQStatus::Shutdown);
+    }
+}
+
+int main()
+{
+    perProducerOrder();
+    roundRobin();
+    overflowPolicies();
+    closeWakesWaiters();
+
+    return check::result();
+}
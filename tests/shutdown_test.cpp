@@ -0,0 +1,126 @@
+#include "mdsp_common/channel.h"
+#include <thread>
+#include <vector>
+#include "check.h"
+
+using namespace mdsp;
+
+namespace
+{
+    struct Work : Awaitable {};
+    struct Data { int value; };
+
+    using Messages = std::variant<Data, Work>;
+
+    // Closing or clearing a channel destroys the queued commands, which unblocks their awaiters with Shutdown
+    template<typename Backend>
+    void closeUnblocksAwaitables()
+    {
+        Channel<Messages, Backend> ch;
+        ch.open(ChannelConfig{}.withCapacity(10));
+
+        Awaitable closed(1);
+        ch.send(Work{ closed });
+        ch.close();
+
+        CHECK(closed.wait(Time::FromMilliseconds(10)) == Awaitable::Shutdown);
+
+        auto [status, msg] = ch.recv(Time::FromMilliseconds(10));
+        CHECK(status == SyncQStatus::Shutdown);
+
+        ch.open(ChannelConfig{}.withCapacity(10));
+
+        Awaitable cleared(1);
+        ch.send(Work{ cleared });
+        ch.clear();
+
+        CHECK(cleared.wait(Time::FromMilliseconds(10)) == Awaitable::Shutdown);
+        CHECK(ch.empty());
+    }
+
+    // Items sent after clear() are delivered, only the ones queued before it are dropped
+    template<typename Backend>
+    void clearKeepsLaterItems()
+    {
+        Channel<Messages, Backend> ch;
+        ch.open(ChannelConfig{}.withCapacity(10));
+
+        ch.send(Data{ 1 });
+        ch.send(Data{ 2 });
+        ch.clear();
+        ch.send(Data{ 3 });
+
+        auto [status, msg] = ch.recv(Time::FromMilliseconds(10));
+        CHECK(status == SyncQStatus::OK);
+        CHECK(std::holds_alternative<Data>(msg) && std::get<Data>(msg).value == 3);
+        CHECK(ch.empty());
+    }
+
+    // close(ClearCache(false)) keeps the queued messages, recv returns Shutdown once they're received
+    template<typename Backend>
+    void closeKeepsQueued()
+    {
+        Channel<Messages, Backend> ch;
+        ch.open(ChannelConfig{}.withCapacity(10));
+
+        ch.send(Data{ 1 });
+        ch.close(ClearCache(false));
+        ch.send(Data{ 2 });
+
+        auto [first, msg] = ch.recv(Time::FromMilliseconds(10));
+        CHECK(first == SyncQStatus::OK);
+        CHECK(std::holds_alternative<Data>(msg) && std::get<Data>(msg).value == 1);
+
+        auto [second, none] = ch.recv(Time::FromMilliseconds(10));
+        CHECK(second == SyncQStatus::Shutdown);
+    }
+
+    // A producer blocked on a full channel that gets a slot while the channel closes doesn't leak the slot
+    template<typename Backend>
+    void closeKeepsCapacity()
+    {
+        Channel<Messages, Backend> ch;
+        auto config = ChannelConfig{}.withCapacity(1).withSendTimeout(Time::FromMilliseconds(50));
+
+        for (int i = 0; i < 200; ++i)
+        {
+            ch.open(config);
+            ch.send(Data{ 1 });
+
+            std::thread producer([&]() { ch.send(Data{ 2 }); });
+
+            // Let the producer block, then free its slot and close right away
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            ch.recv(Time::Zero());
+            ch.close();
+
+            producer.join();
+        }
+
+        ch.open(config);
+
+        std::vector<Messages> batch{ Data{ 3 } };
+        CHECK(ch.sendBatch(batch) == 1);
+    }
+
+    template<typename Backend>
+    void run()
+    {
+        closeUnblocksAwaitables<Backend>();
+        clearKeepsLaterItems<Backend>();
+        closeKeepsQueued<Backend>();
+        closeKeepsCapacity<Backend>();
+    }
+}
+
+int main()
+{
+    run<backend::Mutex>();
+    run<backend::Ring>();
+    run<backend::Coalescing<>>();
+    run<backend::SPSC>();
+    run<backend::MPMC>();
+    run<backend::Sharded<>>();
+
+    return check::result();
+}
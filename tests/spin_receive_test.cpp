@@ -0,0 +1,103 @@
+#include "mdsp_common/channel.h"
+#include <thread>
+#include "check.h"
+
+using namespace mdsp;
+
+namespace
+{
+    struct Data { int value; };
+
+    using Messages = std::variant<Data>;
+
+    // A zero timeout polls once, the spins count never outlasts the timeout
+    void spinBoundedByTimeout()
+    {
+        SpinPolicy policy{ size_t(1) << 40, 10_s, 1000000 };
+        int polls = 0;
+
+        CHECK(!policy.spinUntil(Time::Zero(), [&]() { ++polls; return false; }));
+        CHECK(polls == 1);
+
+        auto start = Time::NowSteady();
+        CHECK(!policy.spinUntil(2_ms, []() { return false; }));
+        auto elapsed = Time::NowSteady() - start;
+
+        CHECK(elapsed >= 2_ms && elapsed < 1_s);
+
+        polls = 0;
+        CHECK(policy.spinUntil(1_s, [&]() { return ++polls == 100; }));
+    }
+
+    // Huge timeouts saturate instead of overflowing into the past
+    void deadlineSaturates()
+    {
+        auto now = std::chrono::steady_clock::now();
+
+        CHECK(deadlineAfter(Time::Max()) > now);
+        CHECK(deadlineAfter(Time::Zero()) >= now);
+
+        auto past = deadlineAfter(-1_s);
+        CHECK(past <= std::chrono::steady_clock::now());
+    }
+
+    // Spinning consumer picks up a message sent from another thread, spin budget lasting longer than the wait
+    template<typename Backend>
+    void spinningReceive()
+    {
+        Channel<Messages, Backend> ch;
+        ch.open(ChannelConfig{}.withRecvSpin(1000, 50_ms, 10));
+
+        std::thread producer([&]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ch.send(Data{ 7 });
+        });
+
+        auto [status, msg] = ch.recv(1_s);
+
+        producer.join();
+
+        CHECK(status == SyncQStatus::OK && std::get<Data>(msg).value == 7);
+    }
+
+    // Sub-millisecond timeouts are neither truncated to zero nor rounded up to milliseconds,
+    // spinning or not, and a zero timeout returns right away
+    template<typename Backend>
+    void shortTimeouts(SpinPolicy spin)
+    {
+        Channel<Messages, Backend> ch;
+        ch.open(ChannelConfig{}.withRecvSpin(spin.spins, spin.budget, spin.yields));
+
+        auto start = Time::NowSteady();
+        auto [status, msg] = ch.recv(300_us);
+        auto elapsed = Time::NowSteady() - start;
+
+        CHECK(status == SyncQStatus::Timeout);
+        CHECK(elapsed >= 300_us && elapsed < 100_ms);
+
+        start = Time::NowSteady();
+        CHECK(ch.recv(Time::Zero()).first == SyncQStatus::Timeout);
+        CHECK(Time::NowSteady() - start < 100_ms);
+    }
+
+    template<typename Backend>
+    void backendSuite()
+    {
+        spinningReceive<Backend>();
+        shortTimeouts<Backend>({});
+        shortTimeouts<Backend>({ 1000, 10_ms, 10 });
+    }
+}
+
+int main()
+{
+    spinBoundedByTimeout();
+    deadlineSaturates();
+
+    backendSuite<backend::Mutex>();
+    backendSuite<backend::SPSC>();
+    backendSuite<backend::MPMC>();
+
+    return check::result();
+}
@@ -0,0 +1,291 @@
+#include "mdsp_common/wrapper.h"
+#include "thread.h"
+#include <chrono>
+#include <vector>
+#include "check.h"
+
+using namespace cisim;
+
+namespace
+{
+    struct Sleep : Awaitable { int ms = 0; };
+    struct Work : Awaitable {};
+    struct Count {};
+
+    using Commands = std::variant<Work, Sleep, Count>;
+
+    template<typename Backend>
+    struct WorkerState {};
+
+    template<typename Backend>
+    class Worker
+        : public Thread<WorkerState<Backend>, Commands, Backend>
+    {
+    public:
+        std::atomic<int> executed = 0;
+        std::atomic<int> exits = 0;
+        std::atomic<int> counted = 0;
+        std::atomic<int> starts = 0;
+        std::atomic<int> stops = 0;
+
+        void execute(WorkerState<Backend>&, Work&)
+        {
+            ++executed;
+        }
+
+        void execute(WorkerState<Backend>&, Sleep& sleep)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(sleep.ms));
+            ++executed;
+        }
+
+        void execute(WorkerState<Backend>&, Count&)
+        {
+            ++counted;
+        }
+
+        void onExit(WorkerState<Backend>&)
+        {
+            ++exits;
+        }
+
+        void onStart(WorkerState<Backend>&)
+        {
+            ++starts;
+        }
+
+        void onStop()
+        {
+            ++stops;
+        }
+    };
+
+    template<typename Backend>
+    Awaitable sleepOn(Worker<Backend>& worker, int ms)
+    {
+        Awaitable done(1);
+        worker.async(Sleep{ done, ms });
+
+        return done;
+    }
+
+    Time elapsedSince(Time start)
+    {
+        return Time::NowSteady() - start;
+    }
+
+    // The worker waiting for commands (consumerTimeout is 5 s by default) wakes up right away
+    template<typename Backend>
+    void stopWakesUp(size_t batch)
+    {
+        Worker<Backend> worker;
+        worker.start({}, ThreadConfig{}.withBatch(batch));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        auto start = Time::NowSteady();
+        worker.stop();
+
+        CHECK(elapsedSince(start) < Time::FromSeconds(1));
+        CHECK(worker.exits == 1);
+    }
+
+    // Commands queued behind the one being executed are dropped and their callers get Shutdown
+    template<typename Backend>
+    void stopUnblocksQueued(size_t batch)
+    {
+        Worker<Backend> worker;
+        worker.start({}, ThreadConfig(ChannelConfig{}.withCapacity(100)).withBatch(batch));
+
+        // The first command keeps the worker busy until the rest is queued, so with batch > 1 they're received together
+        auto first = sleepOn(worker, 20);
+
+        std::vector<Awaitable> queued;
+
+        for (int i = 0; i < 6; ++i)
+            queued.push_back(sleepOn(worker, 50));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(40));
+
+        auto start = Time::NowSteady();
+        worker.stop();
+
+        // Only the command in progress is finished, not the rest of its batch
+        CHECK(elapsedSince(start) < Time::FromMilliseconds(150));
+        CHECK(first.wait(Time::FromMilliseconds(10)) == Awaitable::OK);
+        CHECK(worker.executed < 4);
+
+        for (auto& awaitable : queued)
+            CHECK(awaitable.wait(Time::FromMilliseconds(10)) != Awaitable::Timeout);
+
+        // Commands sent to a stopped thread are dropped right away
+        auto late = worker.template async<Work>();
+        CHECK(late.wait(Time::FromMilliseconds(10)) == Awaitable::Shutdown);
+    }
+
+    template<typename Backend>
+    void drainExecutesQueued(size_t batch)
+    {
+        Worker<Backend> worker;
+        worker.start({}, ThreadConfig(ChannelConfig{}.withCapacity(100)).withBatch(batch));
+
+        std::vector<Awaitable> queued;
+
+        for (int i = 0; i < 10; ++i)
+            queued.push_back(worker.template async<Work>());
+
+        CHECK(worker.drain(Time::NowSteady() + Time::FromSeconds(5)));
+        CHECK(worker.executed == 10);
+        CHECK(worker.exits == 1);
+
+        for (auto& awaitable : queued)
+            CHECK(awaitable.wait(Time::FromMilliseconds(10)) == Awaitable::OK);
+    }
+
+    template<typename Backend>
+    void drainStopsAtDeadline(size_t batch)
+    {
+        Worker<Backend> worker;
+        worker.start({}, ThreadConfig(ChannelConfig{}.withCapacity(100)).withBatch(batch));
+
+        std::vector<Awaitable> queued;
+
+        for (int i = 0; i < 10; ++i)
+            queued.push_back(sleepOn(worker, 20));
+
+        auto start = Time::NowSteady();
+
+        CHECK(!worker.drain(start + Time::FromMilliseconds(50)));
+        CHECK(elapsedSince(start) < Time::FromMilliseconds(150));
+        CHECK(worker.executed < 10);
+
+        int shutdown = 0;
+
+        for (auto& awaitable : queued)
+        {
+            auto result = awaitable.wait(Time::FromMilliseconds(10));
+
+            CHECK(result != Awaitable::Timeout);
+
+            if (result == Awaitable::Shutdown)
+                ++shutdown;
+        }
+
+        CHECK(shutdown == 10 - worker.executed);
+    }
+
+    // Timers fire between commands, periodic ones until cancelled
+    template<typename Backend>
+    void timersFire(size_t batch)
+    {
+        Worker<Backend> worker;
+        worker.start({}, ThreadConfig{}.withBatch(batch));
+
+        worker.asyncAfter(Time::FromMilliseconds(10), Count{});
+        auto cancelled = worker.asyncAfter(Time::FromMilliseconds(30), Count{});
+        CHECK(worker.cancel(cancelled));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        CHECK(worker.counted == 1);
+
+        auto every = worker.asyncEvery(Time::FromMilliseconds(10), Count{});
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        CHECK(worker.cancel(every));
+        CHECK(!worker.cancel(every));
+
+        int counted = worker.counted;
+        CHECK(counted > 3);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        CHECK(worker.counted == counted);
+
+        worker.stop();
+    }
+
+    // A whole consumerTimeout without commands executes the default command (Work), with any batch size,
+    // waits cut short by a timer don't
+    template<typename Backend>
+    void idleExecutesDefault(size_t batch)
+    {
+        Worker<Backend> idle;
+        idle.start({}, ThreadConfig(ChannelConfig{}.withRecvTimeout(Time::FromMilliseconds(20))).withBatch(batch));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(110));
+        idle.stop();
+
+        CHECK(idle.executed >= 3);
+
+        Worker<Backend> timed;
+        timed.start({}, ThreadConfig(ChannelConfig{}.withRecvTimeout(Time::FromMilliseconds(50))).withBatch(batch));
+
+        auto every = timed.asyncEvery(Time::FromMilliseconds(5), Count{});
+        std::this_thread::sleep_for(std::chrono::milliseconds(120));
+
+        CHECK(timed.cancel(every));
+        timed.stop();
+
+        CHECK(timed.executed == 0);
+        CHECK(timed.counted > 3);
+    }
+
+    // A thread setup failure still pairs onStart with onStop
+    template<typename Backend>
+    void startFailureStops()
+    {
+        Worker<Backend> worker;
+
+        // No such CPU, setting the affinity fails
+        CHECK(bool(worker.start({}, ThreadConfig{}.withCpus({ size_t(1) << 20 }))));
+        CHECK(!worker.running);
+        CHECK(worker.starts == 1 && worker.stops == 1);
+        CHECK(worker.exits == 0);
+    }
+
+    // The profiler only exists with ThreadConfig::profile
+    template<typename Backend>
+    void profiles(size_t batch)
+    {
+        for (bool enabled : { false, true })
+        {
+            Worker<Backend> worker;
+            worker.start({}, ThreadConfig{}.withBatch(batch).withProfiling(enabled));
+
+            CHECK(worker.template async<Work>().wait(Time::FromSeconds(1)) == Awaitable::OK);
+
+            worker.stop();
+
+            auto profile = worker.profile();
+
+            if (enabled)
+                CHECK(profile.commands.size() == std::variant_size_v<Commands> && profile.commands[0].count == 1);
+            else
+                CHECK(profile.commands.empty());
+        }
+    }
+
+    template<typename Backend>
+    void run()
+    {
+        startFailureStops<Backend>();
+
+        for (size_t batch : { size_t(1), size_t(8) })
+        {
+            stopWakesUp<Backend>(batch);
+            stopUnblocksQueued<Backend>(batch);
+            drainExecutesQueued<Backend>(batch);
+            drainStopsAtDeadline<Backend>(batch);
+            timersFire<Backend>(batch);
+            idleExecutesDefault<Backend>(batch);
+            profiles<Backend>(batch);
+        }
+    }
+}
+
+int main()
+{
+    run<backend::Mutex>();
+    run<backend::MPMC>();
+
+    return check::result();
+}
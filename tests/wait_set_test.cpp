@@ -0,0 +1,154 @@
+#include "mdsp_common/channel.h"
+#include "mdsp_common/wait_set.h"
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.h"
+
+using namespace mdsp;
+
+namespace
+{
+    struct Command { int value; };
+
+    using Commands = std::variant<Command>;
+
+    // Items reach the handler of their own queue, across message types and backends
+    void dispatchesByQueue()
+    {
+        Channel<Commands> commands;
+        Channel<Commands, backend::SPSC> fast;
+        SyncQueue<std::string> names;
+
+        commands.open(ChannelConfig{});
+        fast.open(ChannelConfig{});
+        names.shouldReceive(true);
+
+        auto waitSet = makeWaitSet(SelectOrder::Priority, commands, fast, names);
+
+        std::vector<std::string> seen;
+
+        auto select = [&]()
+        {
+            return waitSet.select(Time::Zero(),
+                [&](Commands&& cmd) { seen.push_back("c" + std::to_string(std::get<Command>(cmd).value)); },
+                [&](Commands&& cmd) { seen.push_back("f" + std::to_string(std::get<Command>(cmd).value)); },
+                [&](std::string&& name) { seen.push_back(name); });
+        };
+
+        names.add("n");
+        fast.send(Command{ 2 });
+
+        CHECK(select() == SyncQStatus::OK);
+        CHECK(select() == SyncQStatus::OK);
+        CHECK(select() == SyncQStatus::Timeout);
+
+        CHECK((seen == std::vector<std::string>{ "f2", "n" }));
+    }
+
+    std::vector<int> order(SelectOrder selectOrder)
+    {
+        SyncQueue<int> first;
+        SyncQueue<int> second;
+
+        first.shouldReceive(true);
+        second.shouldReceive(true);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            first.add(i);
+            second.add(10 + i);
+        }
+
+        WaitSet<SyncQueue<int>, SyncQueue<int>> waitSet(selectOrder, first, second);
+
+        std::vector<int> seen;
+        auto handler = [&](int value) { seen.push_back(value); };
+
+        CHECK(waitSet.drain(handler, handler) == 6);
+
+        return seen;
+    }
+
+    // Fair alternates between ready queues, Priority empties the first one before the second
+    void selectOrder()
+    {
+        CHECK((order(SelectOrder::Fair) == std::vector<int>{ 0, 10, 1, 11, 2, 12 }));
+        CHECK((order(SelectOrder::Priority) == std::vector<int>{ 0, 1, 2, 10, 11, 12 }));
+    }
+
+    // Blocked select wakes up on an item sent from another thread, without a deadline with Time::Max()
+    void wakesUp()
+    {
+        SyncQueue<int> first;
+        SyncQueue<int> second;
+
+        first.shouldReceive(true);
+        second.shouldReceive(true);
+
+        WaitSet<SyncQueue<int>, SyncQueue<int>> waitSet(SelectOrder::Fair, first, second);
+
+        auto start = Time::NowSteady();
+        CHECK(waitSet.select(2_ms, [](int) {}, [](int) {}) == SyncQStatus::Timeout);
+        CHECK(Time::NowSteady() - start >= 2_ms);
+
+        std::thread producer([&]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            second.add(7);
+        });
+
+        int received = 0;
+        CHECK(waitSet.select(Time::Max(), [](int) {}, [&](int value) { received = value; }) == SyncQStatus::OK);
+        CHECK(received == 7);
+
+        producer.join();
+    }
+
+    // Shutdown only once every queue is closed and drained, a blocked select wakes up on close
+    void shutdown()
+    {
+        SyncQueue<int> first;
+        SyncQueue<int> second;
+
+        first.shouldReceive(true);
+        second.shouldReceive(true);
+
+        WaitSet<SyncQueue<int>, SyncQueue<int>> waitSet(SelectOrder::Fair, first, second);
+
+        auto ignore = [](int) {};
+
+        first.add(1);
+        first.shouldReceive(false, ClearCache(false));
+
+        CHECK(waitSet.select(Time::Zero(), ignore, ignore) == SyncQStatus::OK);
+        CHECK(waitSet.select(Time::Zero(), ignore, ignore) == SyncQStatus::Timeout);
+
+        std::thread closer([&]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            second.shouldReceive(false);
+        });
+
+        CHECK(waitSet.select(Time::Max(), ignore, ignore) == SyncQStatus::Shutdown);
+
+        closer.join();
+
+        first.shouldReceive(true);
+        first.add(2);
+
+        int received = 0;
+        CHECK(waitSet.select(Time::Zero(), [&](int value) { received = value; }, ignore) == SyncQStatus::OK);
+        CHECK(received == 2);
+    }
+}
+
+int main()
+{
+    dispatchesByQueue();
+    selectOrder();
+    wakesUp();
+    shutdown();
+
+    return check::result();
+}
@@ -1,6 +1,16 @@
 #pragma once
 #include <thread>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <string>
+#include <future>
+#include <system_error>
 #include "mdsp_common/channel.h"
+#include "mdsp_common/timer_wheel.h"
+#include "thread_affinity.h"
+#include "command_profile.h"
 
 namespace cisim
 {
@@ -18,14 +28,248 @@ namespace cisim
         void onExit(State& state) {}
     };
 
-    template <typename State, typename Commands>
+    // Statistics of a fixed-rate Thread (ThreadConfig::tickPeriod)
+    struct TickStats
+    {
+        uint64_t ticks = 0;
+
+        // Ticks skipped because the thread fell a whole period or more behind
+        uint64_t overruns = 0;
+
+        // How late tick() was called after its deadline
+        Time lastJitter = Time::Zero();
+        Time maxJitter = Time::Zero();
+        Time meanJitter = Time::Zero();
+    };
+
+    struct ThreadConfig
+    {
+        // A thread that receives nothing for a whole channel.consumerTimeout executes a default constructed command
+        // (the first Commands alternative), with any batch size. Waits cut short by timers or tickPeriod don't count.
+        ChannelConfig channel;
+
+        // Maximum number of commands received and executed per wakeup, tick is called once per batch
+        size_t batch = 1ull;
+
+        // Non-zero makes tick fixed-rate: it's called every tickPeriod regardless of the traffic,
+        // commands are only received until the next tick deadline. Zero calls tick after every wakeup.
+        Time tickPeriod = Time::Zero();
+
+        // Records execution time of every command alternative and of tick, see Thread::profile()
+        bool profile = false;
+
+        // CPUs the thread is pinned to, empty leaves the affinity unchanged
+        std::vector<size_t> cpus;
+
+        SchedulingPolicy policy = SchedulingPolicy::Inherit;
+        int priority = 0;
+
+        // Thread name shown by debuggers and profilers
+        std::string name;
+
+        constexpr ThreadConfig() = default;
+
+        constexpr ThreadConfig(const ChannelConfig& channel)
+            : channel(channel)
+        {
+        }
+
+        [[nodiscard]]
+        constexpr ThreadConfig withBatch(size_t size)
+        {
+            auto config = *this;
+            config.batch = size;
+
+            return config;
+        }
+
+        [[nodiscard]]
+        constexpr ThreadConfig withTickPeriod(Time period)
+        {
+            auto config = *this;
+            config.tickPeriod = period;
+
+            return config;
+        }
+
+        [[nodiscard]]
+        constexpr ThreadConfig withProfiling(bool enabled = true)
+        {
+            auto config = *this;
+            config.profile = enabled;
+
+            return config;
+        }
+
+        [[nodiscard]]
+        ThreadConfig withCpus(std::vector<size_t> set)
+        {
+            auto config = *this;
+            config.cpus = std::move(set);
+
+            return config;
+        }
+
+        [[nodiscard]]
+        ThreadConfig withScheduling(SchedulingPolicy schedulingPolicy, int schedulingPriority)
+        {
+            auto config = *this;
+            config.policy = schedulingPolicy;
+            config.priority = schedulingPriority;
+
+            return config;
+        }
+
+        [[nodiscard]]
+        ThreadConfig withName(std::string threadName)
+        {
+            auto config = *this;
+            config.name = std::move(threadName);
+
+            return config;
+        }
+    };
+
+    template <typename State, typename Commands, typename Backend = backend::Mutex>
     class Thread
         : public DefaultHandlers<State>
     {
     protected:
-        Channel<Commands> channel;
+        // Commands as stored in the channel, large alternatives are boxed with backend::OutOfLine
+        using Message = typename Channel<Commands, Backend>::Queue::value_type;
+
+        Channel<Commands, Backend> channel;
         std::thread thread;
 
+        std::mutex timersMutex;
+        TimerWheel<Message> timers;
+
+        // Mirrors timers.nextDeadline() (Max when there are no timers), updated under timersMutex,
+        // so the loop doesn't lock or read the clock when no timer is due
+        std::atomic<Time> timersDeadline = Time::Max();
+
+        // Written by the thread only, read by tickStats()
+        std::atomic<uint64_t> ticks = 0;
+        std::atomic<uint64_t> overruns = 0;
+        std::atomic<Time> lastJitter = Time::Zero();
+        std::atomic<Time> maxJitter = Time::Zero();
+        std::atomic<Time> totalJitter = Time::Zero();
+
+        // Allocated by start() with ThreadConfig::profile, it's kept afterwards so that the profile can be read after stop()
+        std::unique_ptr<CommandProfiler<Commands>> profiler;
+
+        // Set by drain(), the thread stops executing commands once NowSteady() passes drainDeadline
+        std::atomic_bool draining = false;
+        std::atomic<Time> drainDeadline = Time::Max();
+
+        // Set by the thread when it exits on a closed and empty channel, i.e. drain() executed everything
+        std::atomic_bool drained = false;
+
+        bool drainExpired() const
+        {
+            return draining.load(std::memory_order_relaxed) && Time::NowSteady() >= drainDeadline.load(std::memory_order_relaxed);
+        }
+
+        void ticked(Time jitter)
+        {
+            lastJitter.store(jitter, std::memory_order_relaxed);
+            totalJitter.store(totalJitter.load(std::memory_order_relaxed) + jitter, std::memory_order_relaxed);
+
+            if (jitter > maxJitter.load(std::memory_order_relaxed))
+                maxJitter.store(jitter, std::memory_order_relaxed);
+
+            ticks.fetch_add(1, std::memory_order_release);
+        }
+
+        // Called under timersMutex after the timers changed
+        void timersChanged()
+        {
+            timersDeadline.store(timers.nextDeadline().value_or(Time::Max()), std::memory_order_release);
+        }
+
+        // Shortens the receive timeout so that the thread wakes up for the next timer
+        Time timerWait(Time timeout)
+        {
+            auto next = timersDeadline.load(std::memory_order_acquire);
+
+            if (next == Time::Max())
+                return timeout;
+
+            return (std::min)(timeout, (std::max)(next - Time::NowSteady(), Time::Zero()));
+        }
+
+        // Collects the due timer commands under the lock and executes them outside of it,
+        // so that commands can add and cancel timers. One-shot commands are moved out, periodic ones copied.
+        template<typename F>
+        void fireTimers(std::vector<Message>& due, F&& process)
+        {
+            auto next = timersDeadline.load(std::memory_order_acquire);
+
+            if (next == Time::Max())
+                return;
+
+            auto now = Time::NowSteady();
+
+            if (now < next)
+                return;
+
+            {
+                std::lock_guard lock{ timersMutex };
+
+                timers.advance(now, [&](auto&& cmd) {
+                    due.push_back(std::forward<decltype(cmd)>(cmd));
+                });
+
+                timersChanged();
+            }
+
+            for (auto& cmd : due)
+                process(cmd);
+
+            due.clear();
+        }
+
+        TimerId addTimer(Time delay, Time period, Message cmd)
+        {
+            std::unique_lock lock{ timersMutex };
+
+            auto next = timers.nextDeadline();
+            auto deadline = Time::NowSteady() + delay;
+            auto id = timers.add(deadline, std::move(cmd), period);
+
+            timersChanged();
+
+            lock.unlock();
+
+            // The thread may be waiting for a later deadline
+            if (!next || deadline < *next)
+                channel.interrupt();
+
+            return id;
+        }
+
+        // Joins the thread and closes the channel, commands that weren't executed are dropped
+        // and their Awaitables are unblocked with Shutdown
+        template <typename Self>
+        void finish(this Self&& self)
+        {
+            if (self.thread.joinable())
+                self.thread.join();
+
+            // Destroys the remaining commands on this thread (the receiver is gone, so SPSC allows it)
+            self.channel.close();
+
+            {
+                std::lock_guard lock{ self.timersMutex };
+                self.timers.clear();
+                self.timersChanged();
+            }
+
+            self.draining = false;
+
+            self.onStop();
+        }
+
     public:
         std::atomic_bool running = false;
 
@@ -35,30 +279,54 @@ namespace cisim
         virtual ~Thread()
         {}
 
+        // CPU affinity, scheduling policy and name from config are applied on the new thread before onEnter.
+        // If any of them fails, the thread exits without calling onEnter/onExit, onStop pairs the onStart
+        // that already ran, the error is returned and the Thread is left stopped.
         template <typename Self>
-        void start(this Self&& self, State state, const ChannelConfig& config)
+        std::error_code start(this Self&& self, State state, const ThreadConfig& config)
         {
             if (self.running)
-                return;
+                return {};
+
+            self.channel.open(config.channel);
+
+            self.ticks = 0;
+            self.overruns = 0;
+            self.lastJitter = Time::Zero();
+            self.maxJitter = Time::Zero();
+            self.totalJitter = Time::Zero();
 
-            self.channel.open(config);
+            self.draining = false;
+            self.drainDeadline = Time::Max();
+            self.drained = false;
+
+            if (config.profile && !self.profiler)
+                self.profiler = std::make_unique<CommandProfiler<Commands>>();
 
             self.running = true;
 
             self.onStart(state);
 
-            self.thread = std::thread([&, state = std::move(state)]() mutable
+            std::promise<std::error_code> applied;
+            auto setup = applied.get_future();
+
+            self.thread = std::thread([&, state = std::move(state), batch = config.batch, timeout = config.channel.consumerTimeout, period = config.tickPeriod, profile = config.profile, config, applied = std::move(applied)]() mutable
             {
-                self.onEnter(state);
+                std::error_code error = setCurrentThreadAffinity(config.cpus);
 
-                while (self.running)
-                {
-                    auto [status, cmd] = self.channel.recv();
+                if (!error)
+                    error = setCurrentThreadScheduling(config.policy, config.priority);
 
-                    if (status == SyncQStatus::Shutdown)
-                        return;
+                if (!error)
+                    error = setCurrentThreadName(config.name);
+
+                applied.set_value(error);
 
-                    std::visit([&](auto&& command) mutable {
+                if (error)
+                    return;
+
+                auto execute = [&](Message& cmd) {
+                    visitUnboxed([&](auto&& command) mutable {
 
                         using C = std::decay_t<decltype(command)>;
 
@@ -67,23 +335,277 @@ namespace cisim
                         if constexpr (cisim::is_awaitable<C>)
                             command.notify();
                     }, cmd);
+                };
+
+                auto process = [&](Message& cmd) {
+                    if (!profile)
+                    {
+                        execute(cmd);
+                        return;
+                    }
+
+                    auto index = cmd.index();
+                    auto start = Time::NowSteady();
+
+                    execute(cmd);
+
+                    self.profiler->record(index, Time::NowSteady() - start);
+                };
+
+                auto runTick = [&]() {
+                    if (!profile)
+                    {
+                        self.tick(state);
+                        return;
+                    }
+
+                    auto start = Time::NowSteady();
 
                     self.tick(state);
+
+                    self.profiler->recordTick(Time::NowSteady() - start);
+                };
+
+                std::vector<Message> due;
+                Time nextTick = Time::NowSteady() + period;
+
+                // Waits for commands no longer than until the next timer or tick deadline
+                auto waitFor = [&]() {
+                    auto wait = self.timerWait(timeout);
+
+                    if (period > Time::Zero())
+                        wait = (std::min)(wait, (std::max)(nextTick - Time::NowSteady(), Time::Zero()));
+
+                    return wait;
+                };
+
+                // A timeout executes the default command, but only after a full consumerTimeout of idling,
+                // not when the wait was cut short for a timer or tick (see ThreadConfig::channel)
+                auto idled = [&](SyncQStatus status, Time wait, Time waitEnd) {
+                    return status == SyncQStatus::Timeout && wait == timeout && Time::NowSteady() >= waitEnd;
+                };
+
+                auto tick = [&]() {
+                    if (period <= Time::Zero())
+                    {
+                        runTick();
+                        return;
+                    }
+
+                    auto now = Time::NowSteady();
+
+                    if (now < nextTick)
+                        return;
+
+                    self.ticked(now - nextTick);
+                    runTick();
+
+                    // Next deadline is kept on the period grid, so the rate doesn't drift
+                    nextTick += period;
+                    now = Time::NowSteady();
+
+                    if (nextTick <= now)
+                    {
+                        auto missed = (now - nextTick).template repr<int64_t>() / period.template repr<int64_t>() + 1;
+
+                        nextTick += period * missed;
+                        self.overruns.fetch_add(uint64_t(missed), std::memory_order_relaxed);
+                    }
+                };
+
+                self.onEnter(state);
+
+                if (batch > 1)
+                {
+                    std::vector<Message> commands;
+                    commands.reserve(batch);
+
+                    while (self.running)
+                    {
+                        commands.clear();
+
+                        auto wait = waitFor();
+                        auto waitEnd = Time::NowSteady() + wait;
+
+                        auto [status, count] = self.channel.recvBatch(std::back_inserter(commands), batch, wait);
+
+                        // Closed channel, drain() has executed everything that was queued
+                        if (status == SyncQStatus::Shutdown)
+                        {
+                            self.drained = true;
+                            break;
+                        }
+
+                        if (idled(status, wait, waitEnd))
+                            commands.emplace_back();
+
+                        for (auto& cmd : commands)
+                        {
+                            // stop() doesn't wait for the rest of the batch
+                            if (!self.running || self.drainExpired())
+                                break;
+
+                            process(cmd);
+
+                            // A fixed-rate tick isn't delayed until the end of the batch
+                            if (period > Time::Zero())
+                                tick();
+                        }
+
+                        if (self.drainExpired())
+                            break;
+
+                        self.fireTimers(due, process);
+
+                        tick();
+                    }
+                }
+                else
+                {
+                    while (self.running)
+                    {
+                        auto wait = waitFor();
+                        auto waitEnd = Time::NowSteady() + wait;
+
+                        auto [status, cmd] = self.channel.recv(wait);
+
+                        if (status == SyncQStatus::Shutdown)
+                        {
+                            self.drained = true;
+                            break;
+                        }
+
+                        if (self.drainExpired())
+                            break;
+
+                        if (status == SyncQStatus::OK || idled(status, wait, waitEnd))
+                            process(cmd);
+
+                        self.fireTimers(due, process);
+
+                        tick();
+                    }
                 }
 
                 self.onExit(state);
             });
+
+            if (auto error = setup.get())
+            {
+                self.running = false;
+                self.finish();
+
+                return error;
+            }
+
+            return {};
         }
 
+        // Stops the thread after the command it's executing, a thread waiting for commands wakes up right away
+        // Queued commands are dropped and their Awaitables are unblocked with Shutdown
         template <typename Self>
         void stop(this Self&& self)
         {
-            running = false;
+            self.running = false;
+            self.channel.interrupt();
+
+            self.finish();
+        }
+
+        // Stops accepting commands and executes the queued ones until deadline (Time::NowSteady() based),
+        // then stops the thread like stop(). Returns false if deadline passed before the queue was empty.
+        //
+        // Example:
+        //      thread.drain(Time::NowSteady() + 500_ms);
+        //
+        template <typename Self>
+        bool drain(this Self&& self, Time deadline)
+        {
+            self.drainDeadline = deadline;
+            self.draining = true;
+
+            // Receiving goes on until the channel is empty, then the thread gets Shutdown
+            self.channel.close(ClearCache(false));
+
+            bool drained = true;
 
             if (self.thread.joinable())
+            {
                 self.thread.join();
+                drained = self.drained;
+            }
 
-            self.onStop();
+            self.running = false;
+            self.finish();
+
+            return drained;
+        }
+
+        // Fixed-rate tick statistics since start(), all zero without ThreadConfig::tickPeriod
+        TickStats tickStats() const
+        {
+            TickStats stats;
+
+            stats.ticks = ticks.load(std::memory_order_acquire);
+            stats.overruns = overruns.load(std::memory_order_relaxed);
+            stats.lastJitter = lastJitter.load(std::memory_order_relaxed);
+            stats.maxJitter = maxJitter.load(std::memory_order_relaxed);
+
+            if (stats.ticks > 0)
+                stats.meanJitter = totalJitter.load(std::memory_order_relaxed) / int64_t(stats.ticks);
+
+            return stats;
+        }
+
+        // Execution time per command alternative and of tick, empty without ThreadConfig::profile
+        // With backend::Instrumented it also carries the channel queueing delay
+        ThreadProfile profile() const
+        {
+            ThreadProfile snapshot;
+
+            if (profiler)
+                snapshot = profiler->snapshot();
+
+            if constexpr (requires { channel.q.metrics(); })
+                snapshot.queue = channel.q.metrics();
+
+            return snapshot;
+        }
+
+        // Zeroes the profile, applied by the thread before it records the next command
+        void resetProfile()
+        {
+            if (profiler)
+                profiler->reset();
+        }
+
+        // Executes cmd on the thread once delay has passed, timers fire between received commands
+        // and never early, but up to the timer resolution (1 ms) late
+        template<typename T>
+        TimerId asyncAfter(Time delay, T cmd)
+        {
+            return addTimer(delay, Time::Zero(), Message(mdsp::detail::toStored<Message>(std::move(cmd))));
+        }
+
+        // Executes cmd on the thread every period (first time after one period) until it's cancelled or the thread stops
+        // If the thread falls behind, missed periods are skipped rather than executed in a burst
+        template<typename T>
+        TimerId asyncEvery(Time period, T cmd)
+        {
+            return addTimer(period, period, Message(mdsp::detail::toStored<Message>(std::move(cmd))));
+        }
+
+        // Returns false if the timer has already fired (asyncAfter) or was cancelled
+        bool cancel(TimerId id)
+        {
+            std::lock_guard lock{ timersMutex };
+
+            if (!timers.cancel(id))
+                return false;
+
+            timersChanged();
+
+            return true;
         }
 
 
@@ -95,13 +617,13 @@ namespace cisim
         }
 
         template<typename T, typename Dispatch = dispatch::Serial, typename... Ts>
-        Awaitable async(Ts&&... args)
+        typename T::awaitable_type async(Ts&&... args)
         {
             static_assert(cisim::is_awaitable<T>,
                 "T is not awaitable and can't be used with async<T>(Ts...) overload"
                 );
 
-            Awaitable awaitable(1);
+            typename T::awaitable_type awaitable(1);
 
             channel.template send<Dispatch>(T{ awaitable, std::forward<Ts>(args)... });
 
@@ -0,0 +1,134 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <system_error>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cisim
+{
+    enum class SchedulingPolicy
+    {
+        // Keep the scheduling class the thread was created with
+        Inherit,
+        // Real-time, runs until it blocks or a higher priority thread preempts it (SCHED_FIFO)
+        Fifo,
+        // Real-time, like Fifo but time-sliced between threads of the same priority (SCHED_RR)
+        RoundRobin
+    };
+
+    // Functions below change the calling thread and return an empty error_code on success
+
+    // Pins the thread to the given CPU indices, empty set leaves the affinity unchanged
+    // On Windows all CPUs have to be in the same processor group (64 logical CPUs per group)
+    inline std::error_code setCurrentThreadAffinity(const std::vector<size_t>& cpus)
+    {
+        if (cpus.empty())
+            return {};
+
+#if defined(_WIN32)
+        GROUP_AFFINITY affinity{};
+        size_t group = cpus.front() / 64;
+
+        for (auto cpu : cpus)
+        {
+            if (cpu / 64 != group)
+                return std::make_error_code(std::errc::invalid_argument);
+
+            affinity.Mask |= KAFFINITY(1) << (cpu % 64);
+        }
+
+        affinity.Group = WORD(group);
+
+        if (!SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr))
+            return std::error_code(int(GetLastError()), std::system_category());
+
+        return {};
+#elif defined(__linux__)
+        size_t count = *std::max_element(cpus.begin(), cpus.end()) + 1;
+        cpu_set_t* set = CPU_ALLOC(count);
+
+        if (!set)
+            return std::make_error_code(std::errc::not_enough_memory);
+
+        size_t size = CPU_ALLOC_SIZE(count);
+
+        CPU_ZERO_S(size, set);
+
+        for (auto cpu : cpus)
+            CPU_SET_S(cpu, size, set);
+
+        int result = pthread_setaffinity_np(pthread_self(), size, set);
+        CPU_FREE(set);
+
+        return std::error_code(result, std::system_category());
+#else
+        return std::make_error_code(std::errc::not_supported);
+#endif
+    }
+
+    // priority is the SCHED_FIFO/SCHED_RR priority (1-99 on Linux, usually needs CAP_SYS_NICE)
+    // Windows has no real-time policies, the thread priority is raised instead:
+    // TIME_CRITICAL for priority >= 90, HIGHEST for >= 50, ABOVE_NORMAL otherwise
+    inline std::error_code setCurrentThreadScheduling(SchedulingPolicy policy, int priority)
+    {
+        if (policy == SchedulingPolicy::Inherit)
+            return {};
+
+#if defined(_WIN32)
+        int level = priority >= 90 ? THREAD_PRIORITY_TIME_CRITICAL
+            : priority >= 50 ? THREAD_PRIORITY_HIGHEST
+            : THREAD_PRIORITY_ABOVE_NORMAL;
+
+        if (!SetThreadPriority(GetCurrentThread(), level))
+            return std::error_code(int(GetLastError()), std::system_category());
+
+        return {};
+#elif defined(__linux__)
+        sched_param param{};
+        param.sched_priority = priority;
+
+        int result = pthread_setschedparam(pthread_self(), policy == SchedulingPolicy::Fifo ? SCHED_FIFO : SCHED_RR, &param);
+
+        return std::error_code(result, std::system_category());
+#else
+        return std::make_error_code(std::errc::not_supported);
+#endif
+    }
+
+    // Name shown by debuggers and profilers, Linux limits it to 15 characters (longer names are truncated)
+    inline std::error_code setCurrentThreadName(const std::string& name)
+    {
+        if (name.empty())
+            return {};
+
+#if defined(_WIN32)
+        int length = MultiByteToWideChar(CP_UTF8, 0, name.c_str(), -1, nullptr, 0);
+        std::wstring wide(size_t(length), L'\0');
+
+        MultiByteToWideChar(CP_UTF8, 0, name.c_str(), -1, wide.data(), length);
+
+        HRESULT result = SetThreadDescription(GetCurrentThread(), wide.c_str());
+
+        if (FAILED(result))
+            return std::error_code(int(result), std::system_category());
+
+        return {};
+#elif defined(__linux__)
+        int result = pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+
+        return std::error_code(result, std::system_category());
+#else
+        return std::make_error_code(std::errc::not_supported);
+#endif
+    }
+}